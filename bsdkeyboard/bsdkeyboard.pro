@@ -7,9 +7,17 @@ load(qt_plugin)
 
 QT += core gui-private
 
-HEADERS = qbsdkeyboard.h
+HEADERS = qbsdkeyboard.h \
+         qbsdburstdetector.h \
+         qbsdhidkeyboard.h \
+         qbsdkeymap.h
 SOURCES = main.cpp \
-         qbsdkeyboard.cpp
+         qbsdkeyboard.cpp \
+         qbsdburstdetector.cpp \
+         qbsdhidkeyboard.cpp \
+         qbsdkeymap.cpp
+
+include(../shared/shared.pri)
 
 OTHER_FILES += \
     qbsdkeyboard.json
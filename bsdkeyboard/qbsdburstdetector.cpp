@@ -0,0 +1,117 @@
+/****************************************************************************
+**
+** Copyright (C) 2015-2016 Oleksandr Tymoshenko <gonzo@bluezbox.com>
+**
+** This file is part of the QtGui module of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:LGPL21$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see http://www.qt.io/terms-conditions. For further
+** information use the contact form at http://www.qt.io/contact-us.
+**
+** GNU Lesser General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU Lesser
+** General Public License version 2.1 or version 3 as published by the Free
+** Software Foundation and appearing in the file LICENSE.LGPLv21 and
+** LICENSE.LGPLv3 included in the packaging of this file. Please review the
+** following information to ensure the GNU Lesser General Public License
+** requirements will be met: https://www.gnu.org/licenses/lgpl.html and
+** http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+**
+** As a special exception, The Qt Company gives you certain additional
+** rights. These rights are described in The Qt Company LGPL Exception
+** version 1.1, included in the file LGPL_EXCEPTION.txt in this package.
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+#include "qbsdburstdetector.h"
+
+QT_BEGIN_NAMESPACE
+
+enum {
+    MaxBurstKeys = 512      // longer than any symbology, stop holding keys back
+};
+
+static bool isTextKey(const QBsdBurstDetector::Key &key)
+{
+    return key.isPress && !key.autoRepeat && !key.text.isEmpty() && key.text.at(0).isPrint();
+}
+
+QBsdBurstDetector::QBsdBurstDetector(int gapMs, int minLength) :
+    m_gap(gapMs),
+    m_minLength(minLength),
+    m_lastTime(0),
+    m_textKeys(0)
+{
+}
+
+bool QBsdBurstDetector::add(const Key &key, qint64 msecs)
+{
+    // shortcuts are never part of a scan
+    if (key.modifiers & (Qt::ControlModifier | Qt::AltModifier | Qt::MetaModifier))
+        return false;
+
+    // a burst starts with a character; Return or Tab suffixes end it
+    if (m_keys.isEmpty() ? !isTextKey(key)
+                         : (key.isPress && !isTextKey(key) && key.qtcode != Qt::Key_Shift))
+        return false;
+
+    if (m_keys.size() >= MaxBurstKeys)
+        return false;
+
+    if (isTextKey(key))
+        ++m_textKeys;
+    m_keys.append(key);
+    m_lastTime = msecs;
+    return true;
+}
+
+QString QBsdBurstDetector::finish(QVector<Key> *replay, QVector<int> *held)
+{
+    QString text;
+
+    if (m_textKeys < m_minLength) {
+        *replay += m_keys;
+    } else {
+        for (int i = 0; i < m_keys.size(); ++i) {
+            const Key &key = m_keys.at(i);
+            if (isTextKey(key)) {
+                text += key.text;
+
+                bool releasedInBurst = false;
+                for (int j = i + 1; j < m_keys.size(); ++j) {
+                    if (m_keys.at(j).nativecode == key.nativecode) {
+                        releasedInBurst = !m_keys.at(j).isPress;
+                        break;
+                    }
+                }
+                if (!releasedInBurst && !held->contains(key.nativecode))
+                    held->append(key.nativecode);
+                continue;
+            }
+
+            // Shift state and releases of keys pressed before the burst
+            // still have to reach the application, or they would stick.
+            bool pressedInBurst = false;
+            for (int j = 0; j < i && !key.isPress; ++j) {
+                if (m_keys.at(j).isPress && m_keys.at(j).nativecode == key.nativecode) {
+                    pressedInBurst = true;
+                    break;
+                }
+            }
+            if (key.qtcode == Qt::Key_Shift || !pressedInBurst)
+                replay->append(key);
+        }
+    }
+
+    m_keys.clear();
+    m_textKeys = 0;
+    return text;
+}
+
+QT_END_NAMESPACE
@@ -0,0 +1,84 @@
+/****************************************************************************
+**
+** Copyright (C) 2015-2016 Oleksandr Tymoshenko <gonzo@bluezbox.com>
+**
+** This file is part of the QtGui module of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:LGPL21$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see http://www.qt.io/terms-conditions. For further
+** information use the contact form at http://www.qt.io/contact-us.
+**
+** GNU Lesser General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU Lesser
+** General Public License version 2.1 or version 3 as published by the Free
+** Software Foundation and appearing in the file LICENSE.LGPLv21 and
+** LICENSE.LGPLv3 included in the packaging of this file. Please review the
+** following information to ensure the GNU Lesser General Public License
+** requirements will be met: https://www.gnu.org/licenses/lgpl.html and
+** http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+**
+** As a special exception, The Qt Company gives you certain additional
+** rights. These rights are described in The Qt Company LGPL Exception
+** version 1.1, included in the file LGPL_EXCEPTION.txt in this package.
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+#ifndef QBSDBURSTDETECTOR_H
+#define QBSDBURSTDETECTOR_H
+
+#include <QString>
+#include <QVector>
+
+QT_BEGIN_NAMESPACE
+
+// Tells keyboard-wedge barcode scanners from typing by timing: a scanner
+// sends its whole code with a few milliseconds between keys, far faster
+// than anybody types. Key events are held while they keep coming in
+// faster than the gap; a long enough run of them is a scan and becomes
+// one piece of text, anything else is handed back for normal delivery.
+class QBsdBurstDetector
+{
+public:
+    struct Key {
+        int nativecode;
+        QString text;
+        int qtcode;
+        Qt::KeyboardModifiers modifiers;
+        bool isPress;
+        bool autoRepeat;
+    };
+
+    QBsdBurstDetector(int gapMs, int minLength);
+
+    int gap() const { return m_gap; }
+    bool isPending() const { return !m_keys.isEmpty(); }
+    bool isExpired(qint64 msecs) const { return isPending() && msecs - m_lastTime > m_gap; }
+
+    // Returns false if the key cannot be part of a burst; the caller
+    // then finishes the current one before delivering the key itself.
+    bool add(const Key &key, qint64 msecs);
+
+    // Ends the current burst. Returns the scanned text, or an empty
+    // string if it was not a scan. Keys that still have to be delivered
+    // normally, in order, are appended to replay. The native codes of
+    // keys that went into the text but are still held are appended to
+    // held; their release comes later and must not be delivered either.
+    QString finish(QVector<Key> *replay, QVector<int> *held);
+
+private:
+    int m_gap;
+    int m_minLength;
+    qint64 m_lastTime;
+    int m_textKeys;
+    QVector<Key> m_keys;
+};
+
+QT_END_NAMESPACE
+
+#endif // QBSDBURSTDETECTOR_H
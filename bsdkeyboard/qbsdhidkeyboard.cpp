@@ -0,0 +1,159 @@
+/****************************************************************************
+**
+** Copyright (C) 2015-2016 Oleksandr Tymoshenko <gonzo@bluezbox.com>
+**
+** This file is part of the QtGui module of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:LGPL21$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see http://www.qt.io/terms-conditions. For further
+** information use the contact form at http://www.qt.io/contact-us.
+**
+** GNU Lesser General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU Lesser
+** General Public License version 2.1 or version 3 as published by the Free
+** Software Foundation and appearing in the file LICENSE.LGPLv21 and
+** LICENSE.LGPLv3 included in the packaging of this file. Please review the
+** following information to ensure the GNU Lesser General Public License
+** requirements will be met: https://www.gnu.org/licenses/lgpl.html and
+** http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+**
+** As a special exception, The Qt Company gives you certain additional
+** rights. These rights are described in The Qt Company LGPL Exception
+** version 1.1, included in the file LGPL_EXCEPTION.txt in this package.
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+#include "qbsdhidkeyboard.h"
+
+#include <string.h>
+
+QT_BEGIN_NAMESPACE
+
+enum {
+    HidUsageErrorRollOver = 0x01,
+    HidUsageFirstKey      = 0x04
+};
+
+// HID keyboard usage page to kbd(4) keycodes, as done by ukbd(4)
+static const quint8 s_usageToKeycode[256] = {
+      0,   0,   0,   0,  30,  48,  46,  32,    /* 00 - 07 */
+     18,  33,  34,  35,  23,  36,  37,  38,    /* 08 - 0F */
+     50,  49,  24,  25,  16,  19,  31,  20,    /* 10 - 17 */
+     22,  47,  17,  45,  21,  44,   2,   3,    /* 18 - 1F */
+      4,   5,   6,   7,   8,   9,  10,  11,    /* 20 - 27 */
+     28,   1,  14,  15,  57,  12,  13,  26,    /* 28 - 2F */
+     27,  43,  43,  39,  40,  41,  51,  52,    /* 30 - 37 */
+     53,  58,  59,  60,  61,  62,  63,  64,    /* 38 - 3F */
+     65,  66,  67,  68,  87,  88,  92,  70,    /* 40 - 47 */
+    104, 102,  94,  96, 103,  99, 101,  98,    /* 48 - 4F */
+     97, 100,  95,  69,  91,  55,  74,  78,    /* 50 - 57 */
+     89,  79,  80,  81,  75,  76,  77,  71,    /* 58 - 5F */
+     72,  73,  82,  83,  86, 107               /* 60 - 65 */
+};
+
+// modifier byte, bit 0 (left Control) to bit 7 (right GUI)
+static const quint8 s_modifierKeycodes[8] = {
+    29, 42, 56, 105, 90, 54, 93, 106
+};
+
+QBsdHidReportDecoder::QBsdHidReportDecoder() :
+    m_length(0),
+    m_modifiers(0)
+{
+    memset(m_report, 0, sizeof(m_report));
+    memset(m_keys, 0, sizeof(m_keys));
+    memset(m_down, 0, sizeof(m_down));
+}
+
+quint16 QBsdHidReportDecoder::keycodeForUsage(quint8 usage)
+{
+    return s_usageToKeycode[usage];
+}
+
+int QBsdHidReportDecoder::push(quint8 byte, KeyEvent *events)
+{
+    m_report[m_length++] = byte;
+    if (m_length < ReportSize)
+        return 0;
+
+    m_length = 0;
+    return diff(m_report, events);
+}
+
+int QBsdHidReportDecoder::diff(const quint8 *report, KeyEvent *events)
+{
+    int n = 0;
+
+    const quint8 changed = m_modifiers ^ report[0];
+    for (int bit = 0; bit < 8; ++bit) {
+        if (!(changed & (1 << bit)))
+            continue;
+        events[n].keycode = s_modifierKeycodes[bit];
+        events[n].pressed = report[0] & (1 << bit);
+        events[n].modifier = true;
+        ++n;
+    }
+    m_modifiers = report[0];
+
+    // too many keys down: the slots are meaningless, keep the previous state
+    for (int i = 2; i < ReportSize; ++i) {
+        if (report[i] == HidUsageErrorRollOver)
+            return n;
+    }
+
+    quint32 down[256 / 32];
+    memset(down, 0, sizeof(down));
+    for (int i = 2; i < ReportSize; ++i) {
+        const quint8 usage = report[i];
+        if (usage >= HidUsageFirstKey)
+            down[usage / 32] |= 1u << (usage % 32);
+    }
+
+    // releases first, so a quick roll never shows two keys down that weren't
+    for (int i = 0; i < 6; ++i) {
+        const quint8 usage = m_keys[i];
+        const quint32 bit = 1u << (usage % 32);
+        if (usage < HidUsageFirstKey || !(m_down[usage / 32] & bit) || (down[usage / 32] & bit))
+            continue;
+        m_down[usage / 32] &= ~bit;
+        if (!s_usageToKeycode[usage])
+            continue;
+        events[n].keycode = s_usageToKeycode[usage];
+        events[n].pressed = false;
+        events[n].modifier = false;
+        ++n;
+    }
+
+    for (int i = 2; i < ReportSize; ++i) {
+        const quint8 usage = report[i];
+        const quint32 bit = 1u << (usage % 32);
+        if (usage < HidUsageFirstKey || (m_down[usage / 32] & bit))
+            continue;
+        m_down[usage / 32] |= bit;
+        if (!s_usageToKeycode[usage])
+            continue;
+        events[n].keycode = s_usageToKeycode[usage];
+        events[n].pressed = true;
+        events[n].modifier = false;
+        ++n;
+    }
+
+    memcpy(m_keys, report + 2, sizeof(m_keys));
+    return n;
+}
+
+int QBsdHidReportDecoder::releaseAll(KeyEvent *events)
+{
+    static const quint8 empty[ReportSize] = { 0 };
+
+    m_length = 0;
+    return diff(empty, events);
+}
+
+QT_END_NAMESPACE
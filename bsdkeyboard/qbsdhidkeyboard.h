@@ -0,0 +1,81 @@
+/****************************************************************************
+**
+** Copyright (C) 2015-2016 Oleksandr Tymoshenko <gonzo@bluezbox.com>
+**
+** This file is part of the QtGui module of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:LGPL21$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see http://www.qt.io/terms-conditions. For further
+** information use the contact form at http://www.qt.io/contact-us.
+**
+** GNU Lesser General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU Lesser
+** General Public License version 2.1 or version 3 as published by the Free
+** Software Foundation and appearing in the file LICENSE.LGPLv21 and
+** LICENSE.LGPLv3 included in the packaging of this file. Please review the
+** following information to ensure the GNU Lesser General Public License
+** requirements will be met: https://www.gnu.org/licenses/lgpl.html and
+** http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+**
+** As a special exception, The Qt Company gives you certain additional
+** rights. These rights are described in The Qt Company LGPL Exception
+** version 1.1, included in the file LGPL_EXCEPTION.txt in this package.
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+#ifndef QBSDHIDKEYBOARD_H
+#define QBSDHIDKEYBOARD_H
+
+#include <QtGlobal>
+
+QT_BEGIN_NAMESPACE
+
+// Turns the 8-byte boot protocol reports of a USB HID keyboard into key
+// presses and releases in kbd(4) keycodes, so they can go through the
+// same keymap as K_CODE input. Successive reports are diffed as key
+// bitmaps, which gives full rollover within the six report slots.
+class QBsdHidReportDecoder
+{
+public:
+    enum {
+        ReportSize = 8,
+        MaxEvents = 8 + 2 * 6       // modifier bits plus a release and a press per slot
+    };
+
+    struct KeyEvent {
+        quint16 keycode;
+        bool pressed;
+        bool modifier;
+    };
+
+    QBsdHidReportDecoder();
+
+    // Collects report bytes; once a report is complete, stores the
+    // resulting events and returns their number.
+    int push(quint8 byte, KeyEvent *events);
+
+    // releases everything currently held and forgets it
+    int releaseAll(KeyEvent *events);
+
+    static quint16 keycodeForUsage(quint8 usage);
+
+private:
+    int diff(const quint8 *report, KeyEvent *events);
+
+    quint8 m_report[ReportSize];
+    int m_length;
+
+    quint8 m_modifiers;
+    quint8 m_keys[6];
+    quint32 m_down[256 / 32];       // usages currently held
+};
+
+QT_END_NAMESPACE
+
+#endif // QBSDHIDKEYBOARD_H
@@ -31,9 +31,22 @@
 ****************************************************************************/
 
 #include "qbsdkeyboard.h"
+#include "qbsdhidkeyboard.h"
+#include "qbsdburstdetector.h"
+#include "qbsddevicemonitor_p.h"
+#include "qbsdeventqueue_p.h"
+#include "qbsdinjectionserver_p.h"
+#include "qbsdinputlogging_p.h"
+#include "qbsdinputtrace_p.h"
+#include "qbsdseat_p.h"
 
 #include <QSocketNotifier>
+#include <QFile>
+#include <QFileSystemWatcher>
+#include <QMutexLocker>
 #include <QStringList>
+#include <QThread>
+#include <QTimer>
 #include <QPoint>
 #include <QGuiApplication>
 #include <qpa/qwindowsysteminterface.h>
@@ -43,16 +56,14 @@
 
 #include <errno.h>
 #include <fcntl.h>
+#include <signal.h>
+#include <string.h>
 #include <unistd.h>
 
 #include <termios.h>
+#include <sys/consio.h>
 #include <sys/kbio.h>
-
-// #define QT_BSD_KEYBOARD_DEBUG
-
-#ifdef QT_BSD_KEYBOARD_DEBUG
-#include <qdebug.h>
-#endif
+#include <sys/socket.h>
 
 QT_BEGIN_NAMESPACE
 
@@ -61,49 +72,315 @@ enum {
     Bsd_KeyPressedMask  = 0x80
 };
 
-#include "qbsdkeyboard_defaultmap.h"
+enum {
+    HidRepeatDelay    = 500,    // ms, the kbdcontrol(1) defaults
+    HidRepeatInterval = 34,
+    HidLedNumLock     = 0x01,   // boot protocol output report
+    HidLedCapsLock    = 0x02,
+    HidLedScrollLock  = 0x04
+};
+
+enum {
+    OpenRetries       = 10,     // after a hotplugged node failed to open
+    OpenRetryInterval = 500     // ms
+};
+
+// The kernel asks us to release or acquire the VT through signals; they are
+// forwarded to the event loop through this socket pair.
+static int s_vtSignalFd[2] = { -1, -1 };
+static struct sigaction s_origRelSigAction;
+static struct sigaction s_origAcqSigAction;
+
+static void vtSignalHandler(int signo)
+{
+    int savedErrno = errno;
+    char c = char(signo);
+    QT_WRITE(s_vtSignalFd[0], &c, sizeof(c));
+    errno = savedErrno;
+}
 
 QBsdKeyboardHandler::QBsdKeyboardHandler(const QString &key,
                                                  const QString &specification) :
     m_kbdOrigTty(0),
+    m_origKbdMode(-1),
+    m_fd(-1),
     m_shouldClose(false),
+    m_vtSwitching(true),
+    m_rawTty(false),
     m_modifiers(0),
-    m_keymap(0),
-    m_keymapSize(0)
+    m_capsLock(false),
+    m_numLock(false),
+    m_scrollLock(false),
+    m_inputState(QBsdInputState::instance()),
+    m_composing(0),
+    m_deadUnicode(0xffff),
+    m_deadKeycode(0),
+    m_deadModifiers(Qt::NoModifier),
+    m_keymap(new QBsdKeymap),
+    m_keymapWatcher(0),
+    m_lastHotkeyId(0),
+    m_origVtMode(0),
+    m_vtNotifier(0),
+    m_vtIndex(0),
+    m_active(true),
+    m_thread(0),
+    m_hidLeds(0),
+    m_hidRepeatTimer(0),
+    m_hidRepeatKeycode(0),
+    m_monitor(0),
+    m_openRetryTimer(0),
+    m_openRetries(0),
+    m_burstTimer(0),
+    m_burstCommit(true),
+    m_eventQueue(new QBsdEventQueue(this)),
+    m_injectionServer(0),
+    m_seat(0),
+    m_stats(0)
 {
     Q_UNUSED(key);
     QByteArray device;
+    QString keymapFile;
+    bool threaded = false;
+    bool hid = false;
+    bool hotplug = false;
+    int scannerGap = 0;
+    int scannerLength = 6;
+    QString injectPath;
+    QString seatName;
+    QString screenName;
+    bool vtSwitching = !qEnvironmentVariableIsSet("QT_QPA_NO_SIGNAL_HANDLER");
+
+    memset(m_hotkeyKeysDown, 0, sizeof(m_hotkeyKeysDown));
+    memset(m_swallowedKeys, 0, sizeof(m_swallowedKeys));
 
     setObjectName(QLatin1String("BSD Keyboard Handler"));
 
-    if (specification.startsWith("/dev/"))
-        device = QFile::encodeName(specification);
+    const QStringList args = specification.split(QLatin1Char(':'));
+    foreach (const QString &arg, args) {
+        if (arg.startsWith(QLatin1Char('/')))
+            device = QFile::encodeName(arg);
+        else if (arg.startsWith(QLatin1String("keymap=")))
+            keymapFile = arg.mid(7);
+        else if (arg == QLatin1String("thread"))
+            threaded = true;
+        else if (arg == QLatin1String("novtswitch"))
+            vtSwitching = false;
+        else if (arg == QLatin1String("hid"))
+            hid = true;
+        else if (arg == QLatin1String("raw"))
+            m_rawTty = true;
+        else if (arg == QLatin1String("hotplug"))
+            hotplug = true;
+        else if (arg.startsWith(QLatin1String("scanner=")))
+            scannerGap = arg.mid(8).toInt();
+        else if (arg.startsWith(QLatin1String("scannerlength=")))
+            scannerLength = arg.mid(14).toInt();
+        else if (arg == QLatin1String("scannermode=signal"))
+            m_burstCommit = false;
+        else if (arg.startsWith(QLatin1String("inject=")))
+            injectPath = arg.mid(7);
+        else if (arg.startsWith(QLatin1String("seat=")))
+            seatName = arg.mid(5);
+        else if (arg.startsWith(QLatin1String("screen=")))
+            screenName = arg.mid(7);
+    }
+
+    m_device = device;
+    m_vtSwitching = vtSwitching;
+
+    m_stats = m_inputState->registerStats("keyboard", device.isEmpty() ? QByteArrayLiteral("stdin") : device);
+    m_eventQueue->setStats(m_stats);
+    m_inputState->addKeyboardHandler(this);
+
+    if (!seatName.isEmpty() || !screenName.isEmpty()) {
+        if (seatName.isEmpty())
+            seatName = QLatin1String("screen-") + screenName;
+        m_seat = m_inputState->seat(seatName);
+        if (!m_seat->bindScreen(screenName))
+            qWarning("Seat %s is already bound to another screen", qPrintable(seatName));
+        m_eventQueue->setSeat(m_seat);
+        // a seat's keys follow the seat's own focus window
+        connect(m_seat, SIGNAL(focusWindowChanged()), this, SLOT(focusWindowChanged()));
+    } else {
+        connect(qApp, SIGNAL(focusWindowChanged(QWindow*)), this, SLOT(focusWindowChanged()));
+    }
+
+    if (hid) {
+        m_hidDecoder.reset(new QBsdHidReportDecoder);
+        m_hidRepeatTimer = new QTimer(this);
+        connect(m_hidRepeatTimer, SIGNAL(timeout()), this, SLOT(repeatHidKey()));
+    }
 
+    if (scannerGap > 0) {
+        // a barcode scanner types on this keyboard
+        m_burstDetector.reset(new QBsdBurstDetector(scannerGap, scannerLength));
+        m_burstClock.start();
+        m_burstTimer = new QTimer(this);
+        m_burstTimer->setSingleShot(true);
+        connect(m_burstTimer, SIGNAL(timeout()), this, SLOT(finishBurst()));
+    }
+
+    if (!keymapFile.isEmpty()) {
+        loadKeymap(keymapFile);
+
+        // pick up keymap updates while running
+        m_keymapWatcher = new QFileSystemWatcher(QStringList(keymapFile), this);
+        connect(m_keymapWatcher, SIGNAL(fileChanged(QString)), this, SLOT(keymapFileChanged(QString)));
+    }
+
+    if (!injectPath.isEmpty()) {
+        // synthetic K_CODE bytes (or HID reports) for load testing
+        m_injectionServer = new QBsdInjectionServer(injectPath, this);
+        connect(m_injectionServer, SIGNAL(received(int,QByteArray)), this, SLOT(injectInput(int,QByteArray)));
+        connect(m_injectionServer, SIGNAL(clientClosed(int)), this, SLOT(injectionClientClosed(int)));
+    }
+
+    if (hotplug && !device.isEmpty()) {
+        m_monitor = new QBsdDeviceMonitor(QFile::decodeName(device), this);
+        connect(m_monitor, SIGNAL(deviceAdded()), this, SLOT(openDevice()));
+        connect(m_monitor, SIGNAL(deviceRemoved()), this, SLOT(closeDevice()));
+        m_openRetryTimer = new QTimer(this);
+        m_openRetryTimer->setSingleShot(true);
+        m_openRetryTimer->setInterval(OpenRetryInterval);
+        connect(m_openRetryTimer, SIGNAL(timeout()), this, SLOT(openDevice()));
+    } else {
+        openDevice();
+    }
+
+    if (threaded) {
+        // not our child: we are about to live in it
+        m_thread = new QThread;
+        m_thread->setObjectName(QLatin1String("BsdKeyboard"));
+        m_thread->start();
+        moveToThread(m_thread);
+    }
+
+    // probing may be slow, do it from the event loop of whichever thread
+    // reads the device rather than holding up application startup
+    if (m_monitor)
+        QMetaObject::invokeMethod(this, "openDevice", Qt::QueuedConnection);
+}
+
+void QBsdKeyboardHandler::openDevice()
+{
+    if (m_fd >= 0)
+        return;
+
+    QByteArray device = m_device;
     if (device.isEmpty()) {
         device = QByteArrayLiteral("STDIN");
         m_fd = fileno(stdin);
+        m_shouldClose = false;
     }
     else {
-        m_fd = QT_OPEN(device.constData(), O_RDONLY);
-        if (!m_fd) {
-            qErrnoWarning(errno, "open(%s) failed", device.constData());
+        // HID devices take the LED state as an output report
+        m_fd = m_hidDecoder ? QT_OPEN(device.constData(), O_RDWR) : -1;
+        if (m_fd < 0)
+            m_fd = QT_OPEN(device.constData(), O_RDONLY);
+        if (m_fd < 0) {
+            // with hotplug, the monitor calls us again once the node shows
+            // up; one that just did may still be busy, or wait for devfs
+            // rules to make it accessible
+            if (m_monitor && errno != ENOENT && m_openRetries < OpenRetries) {
+                ++m_openRetries;
+                m_openRetryTimer->start();
+                return;
+            }
+            if (!m_monitor || errno != ENOENT)
+                qErrnoWarning(errno, "open(%s) failed", device.constData());
+            m_openRetries = 0;
             return;
         }
+        m_openRetries = 0;
         m_shouldClose = true;
     }
 
-    if (ioctl(m_fd, KDGKBMODE, &m_origKbdMode)) {
-        qErrnoWarning(errno, "ioctl(%s, KDGKBMODE) failed", device.constData());
+    if (m_hidDecoder) {
+        // raw boot protocol reports, or a recording of them; the console
+        // driver is not involved. Start from a clean report state.
+        m_hidDecoder.reset(new QBsdHidReportDecoder);
+    } else if (!setupConsole(device)) {
         revertTTYSettings();
         return;
     }
 
-    if (ioctl(m_fd, KDSKBMODE, K_CODE) < 0) {
-        qErrnoWarning(errno, "ioctl(%s, KDSKBMODE) failed", device.constData());
+    if (fcntl(m_fd, F_SETFL, O_NONBLOCK)) {
+        qErrnoWarning(errno, "fcntl(%s, F_SETFL, O_NONBLOCK) failed", device.constData());
         revertTTYSettings();
         return;
     }
 
+    syncLockStates();
+    publishModifiers();
+
+    m_notifier.reset(new QSocketNotifier(m_fd, QSocketNotifier::Read, this));
+    connect(m_notifier.data(), SIGNAL(activated(int)), this, SLOT(readKeyboardData()));
+
+    // Ctrl+Alt+Fn works without this too, but then we never learn that
+    // the terminal went away and keep reading from it
+    if (ioctl(m_fd, VT_GETINDEX, &m_vtIndex) < 0)
+        m_vtIndex = 0;
+    else if (m_vtSwitching)
+        setupVtSwitching();
+}
+
+void QBsdKeyboardHandler::closeDevice()
+{
+    if (m_fd < 0)
+        return;
+
+    // may be called from the notifier's own activation
+    if (m_notifier) {
+        m_notifier->setEnabled(false);
+        m_notifier.take()->deleteLater();
+    }
+    if (m_hidRepeatTimer)
+        m_hidRepeatTimer->stop();
+
+    revertTTYSettings();
+    resetKeyState();
+}
+
+void QBsdKeyboardHandler::resetKeyState()
+{
+    // the application must not be left with keys it will never see go up
+    if (m_hidRepeatTimer)
+        m_hidRepeatTimer->stop();
+    if (m_hidDecoder) {
+        QBsdHidReportDecoder::KeyEvent events[QBsdHidReportDecoder::MaxEvents];
+        m_hidDecoder->releaseAll(events);
+    }
+    qDeleteAll(m_injectHidDecoders);
+    m_injectHidDecoders.clear();
+    releaseKeys(m_keymap.loadAcquire(), false);
+
+    // held scanner keys were typed before the reset
+    finishBurst();
+
+    m_modifiers = 0;
+    m_composing = 0;
+    memset(m_hotkeyKeysDown, 0, sizeof(m_hotkeyKeysDown));
+    memset(m_swallowedKeys, 0, sizeof(m_swallowedKeys));
+    m_composedKeys.clear();
+    publishModifiers();
+}
+
+bool QBsdKeyboardHandler::setupConsole(const QByteArray &device)
+{
+    if (m_rawTty) {
+        // not a console but some other tty, e.g. a pty driven by a test
+        // harness: it is expected to send K_CODE bytes already
+        qCDebug(qLcBsdKeyboard, "Reading keycodes from %s as is", device.constData());
+        m_origKbdMode = -1;
+    } else if (ioctl(m_fd, KDGKBMODE, &m_origKbdMode)) {
+        qErrnoWarning(errno, "ioctl(%s, KDGKBMODE) failed", device.constData());
+        m_origKbdMode = -1;
+        return false;
+    } else if (ioctl(m_fd, KDSKBMODE, K_CODE) < 0) {
+        qErrnoWarning(errno, "ioctl(%s, KDSKBMODE) failed", device.constData());
+        return false;
+    }
+
     struct termios kbdtty;
     if (tcgetattr(m_fd, &kbdtty) == 0) {
 
@@ -120,34 +397,40 @@ QBsdKeyboardHandler::QBsdKeyboardHandler(const QString &key,
         cfsetospeed(&kbdtty, 9600);
         if (tcsetattr(m_fd, TCSANOW, &kbdtty) < 0) {
             qErrnoWarning(errno, "tcsetattr(%s) failed", device.constData());
-            revertTTYSettings();
-            return;
+            return false;
         }
     } else {
         qErrnoWarning(errno, "tcgetattr(%s) failed", device.constData());
-        revertTTYSettings();
-        return;
-    }
-
-    if (fcntl(m_fd, F_SETFL, O_NONBLOCK)) {
-        qErrnoWarning(errno, "fcntl(%s, F_SETFL, O_NONBLOCK) failed", device.constData());
-        revertTTYSettings();
-        return;
+        return false;
     }
 
-    resetKeymap();
-
-    m_notifier.reset(new QSocketNotifier(m_fd, QSocketNotifier::Read, this));
-    connect(m_notifier.data(), SIGNAL(activated(int)), this, SLOT(readKeyboardData()));
+    return true;
 }
 
 QBsdKeyboardHandler::~QBsdKeyboardHandler()
 {
+    m_inputState->removeKeyboardHandler(this);
+
+    if (m_thread) {
+        // the notifier and the watcher have to go away in the thread they live in
+        if (thread() == m_thread && QThread::currentThread() != m_thread)
+            QMetaObject::invokeMethod(this, "detachFromThread", Qt::BlockingQueuedConnection);
+        m_thread->quit();
+        m_thread->wait();
+        delete m_thread;
+    }
+
     revertTTYSettings();
+
+    qDeleteAll(m_injectHidDecoders);
+    releaseRetiredKeymaps();
+    delete m_keymap.load();
 }
 
 void QBsdKeyboardHandler::revertTTYSettings()
 {
+    revertVtSwitching();
+
     if (m_fd >= 0) {
         if (m_kbdOrigTty != 0) {
             tcsetattr(m_fd, TCSANOW, m_kbdOrigTty);
@@ -155,7 +438,8 @@ void QBsdKeyboardHandler::revertTTYSettings()
             m_kbdOrigTty = 0;
         }
 
-        ioctl(m_fd, KDSKBMODE, m_origKbdMode);
+        if (!m_hidDecoder && m_origKbdMode >= 0)
+            ioctl(m_fd, KDSKBMODE, m_origKbdMode);
         if (m_shouldClose)
             close(m_fd);
         m_fd = -1;
@@ -168,91 +452,251 @@ void QBsdKeyboardHandler::readKeyboardData()
 
     forever {
         int result = read(m_fd, buffer, sizeof(buffer));
+        QBSD_TRACE_READ(m_fd, result);
+        m_stats->add(QBsdInputStats::Reads);
 
         if (result == 0) {
             qWarning("Got EOF from the input device.");
+            // a replayed recording has ended, or the tty is gone
+            if (m_monitor)
+                closeDevice();
+            else
+                m_notifier->setEnabled(false);
             return;
         } else if (result < 0) {
             if (errno != EINTR && errno != EAGAIN) {
                 qWarning("Could not read from input device: %s", strerror(errno));
+                // unplugged; the monitor reopens it when it comes back
+                if (m_monitor)
+                    closeDevice();
                 return;
             }
             else
                 break;
         }
 
-        for (int i = 0; i < result; ++i) {
-            quint16 code = buffer[i] & Bsd_KeyCodeMask;
-            bool pressed = (buffer[i] & Bsd_KeyPressedMask) ? false : true;
+        m_stats->add(QBsdInputStats::Bytes, quint64(result));
+        processInput(m_hidDecoder.data(), buffer, result);
+    }
+}
+
+void QBsdKeyboardHandler::processInput(QBsdHidReportDecoder *hidDecoder, const quint8 *data, int size)
+{
+    if (hidDecoder) {
+        for (int i = 0; i < size; ++i)
+            processHidByte(hidDecoder, data[i]);
+        return;
+    }
+
+    for (int i = 0; i < size; ++i) {
+        quint16 code = data[i] & Bsd_KeyCodeMask;
+        bool pressed = (data[i] & Bsd_KeyPressedMask) ? false : true;
+
+        processKeycode(code, pressed, false);
+    }
+}
+
+void QBsdKeyboardHandler::injectInput(int client, const QByteArray &data)
+{
+    m_stats->add(QBsdInputStats::InjectedBatches);
+    m_stats->add(QBsdInputStats::InjectedBytes, quint64(data.size()));
+
+    // a partial report from a client must not shift the device's framing,
+    // nor another client's
+    QBsdHidReportDecoder *hidDecoder = 0;
+    if (m_hidDecoder) {
+        QBsdHidReportDecoder *&decoder = m_injectHidDecoders[client];
+        if (!decoder)
+            decoder = new QBsdHidReportDecoder;
+        hidDecoder = decoder;
+    }
+    processInput(hidDecoder, reinterpret_cast<const quint8 *>(data.constData()), data.size());
+}
+
+void QBsdKeyboardHandler::injectionClientClosed(int client)
+{
+    QBsdHidReportDecoder *hidDecoder = m_injectHidDecoders.take(client);
+    if (!hidDecoder)
+        return;
+
+    // a client that goes away does not leave its keys held down
+    QBsdHidReportDecoder::KeyEvent events[QBsdHidReportDecoder::MaxEvents];
+    processHidEvents(events, hidDecoder->releaseAll(events));
+    delete hidDecoder;
+}
+
+void QBsdKeyboardHandler::processHidByte(QBsdHidReportDecoder *hidDecoder, quint8 byte)
+{
+    QBsdHidReportDecoder::KeyEvent events[QBsdHidReportDecoder::MaxEvents];
+    processHidEvents(events, hidDecoder->push(byte, events));
+}
 
-            processKeycode(code, pressed, false);
+void QBsdKeyboardHandler::processHidEvents(const QBsdHidReportDecoder::KeyEvent *events, int count)
+{
+    for (int i = 0; i < count; ++i) {
+        const QBsdHidReportDecoder::KeyEvent &event = events[i];
+
+        // the keyboard does not repeat by itself; the last key pressed does
+        if (event.pressed && !event.modifier) {
+            m_hidRepeatKeycode = event.keycode;
+            m_hidRepeatTimer->start(HidRepeatDelay);
+        } else if (!event.pressed && event.keycode == m_hidRepeatKeycode) {
+            m_hidRepeatTimer->stop();
         }
+
+        processKeycode(event.keycode, event.pressed, false);
     }
 }
 
-void QBsdKeyboardHandler::processKeyEvent(int nativecode, int unicode, int qtcode,
+void QBsdKeyboardHandler::repeatHidKey()
+{
+    m_hidRepeatTimer->setInterval(HidRepeatInterval);
+    processKeycode(m_hidRepeatKeycode, true, true);
+}
+
+void QBsdKeyboardHandler::processKeyEvent(int nativecode, const QString &text, int qtcode,
                                             Qt::KeyboardModifiers modifiers, bool isPress, bool autoRepeat)
 {
-    QWindowSystemInterface::handleExtendedKeyEvent(0, (isPress ? QEvent::KeyPress : QEvent::KeyRelease),
-                                                   qtcode, modifiers, nativecode, 0, int(modifiers),
-                                                   (unicode != 0xffff ) ? QString(unicode) : QString(), autoRepeat);
+    if (m_burstDetector) {
+        const qint64 now = m_burstClock.elapsed();
+        if (m_burstDetector->isExpired(now))
+            finishBurst();
+
+        const QBsdBurstDetector::Key key = { nativecode, text, qtcode, modifiers, isPress, autoRepeat };
+        if (m_burstDetector->add(key, now)) {
+            m_burstTimer->start(m_burstDetector->gap());
+            return;
+        }
+
+        // whatever was held goes out before this key
+        finishBurst();
+    }
+
+    deliverKeyEvent(nativecode, text, qtcode, modifiers, isPress, autoRepeat);
+}
+
+void QBsdKeyboardHandler::deliverKeyEvent(int nativecode, const QString &text, int qtcode,
+                                          Qt::KeyboardModifiers modifiers, bool isPress, bool autoRepeat)
+{
+    QBSD_TRACE_KEY_EVENT(qtcode, int(modifiers), isPress);
+    m_inputState->recorder.record(QBsdFlightRecorder::KeyEvent, qtcode, int(modifiers), isPress);
+    m_eventQueue->postKeyEvent(nativecode, text, qtcode, modifiers, isPress, autoRepeat);
 }
 
-void QBsdKeyboardHandler::processKeycode(quint16 keycode, bool pressed, bool autorepeat)
+bool QBsdKeyboardHandler::isKeyDown(int keycode) const
 {
-    bool first_press = pressed && !autorepeat;
+    if (keycode < 0 || keycode >= QBsdKeyboardMap::KeycodeCount)
+        return false;
+    return m_keysDown[keycode / 32].load() & (1u << (keycode % 32));
+}
 
-    const QBsdKeyboardMap::Mapping *map_plain = 0;
-    const QBsdKeyboardMap::Mapping *map_withmod = 0;
+void QBsdKeyboardHandler::releaseKeys(const QBsdKeymap *keymap, bool keepModifiers)
+{
+    for (int i = 0; i < QBsdKeyboardMap::KeycodeCount / 32; ++i) {
+        const quint32 down = m_keysDown[i].load();
+        for (int bit = 0; bit < 32; ++bit) {
+            if (!(down & (1u << bit)))
+                continue;
+
+            const quint16 keycode = quint16(i * 32 + bit);
+            if (keepModifiers) {
+                const QBsdKeyboardMap::Mapping *map = keymap->mapping(keycode, QBsdKeyboardMap::ModPlain);
+                if (map && (map->flags & QBsdKeyboardMap::IsModifier))
+                    continue;
+            }
+            processKeycode(keycode, false, false, keymap);
+        }
+    }
+}
 
-    quint8 modifiers = m_modifiers;
+void QBsdKeyboardHandler::processKeycode(quint16 keycode, bool pressed, bool autorepeat,
+                                         const QBsdKeymap *keymap)
+{
+    QBSD_TRACE_KEY_DECODE(keycode, pressed, autorepeat);
+    m_stats->add(QBsdInputStats::Packets);
+    m_inputState->recorder.record(QBsdFlightRecorder::KeyDecode, keycode, pressed, autorepeat);
 
-    // get a specific and plain mapping for the keycode and the current modifiers
-    for (int i = 0; i < m_keymapSize && !(map_plain && map_withmod); ++i) {
-        const QBsdKeyboardMap::Mapping *m = m_keymap + i;
-        if (m->keycode == keycode) {
-            if (m->modifiers == 0)
-                map_plain = m;
-
-            quint8 testmods = m_modifiers;
-            if (m_capsLock && (m->flags & QBsdKeyboardMap::IsLetter))
-                testmods ^= QBsdKeyboardMap::ModShift;
-            if (m->modifiers == testmods)
-                map_withmod = m;
+    if (keycode < QBsdKeyboardMap::KeycodeCount) {
+        QAtomicInteger<quint32> &down = m_keysDown[keycode / 32];
+        const quint32 downBit = 1u << (keycode % 32);
+        if (pressed) {
+            // the key was released for us while it was still held
+            if (autorepeat && !(down.load() & downBit))
+                autorepeat = false;
+            down.fetchAndOrRelaxed(downBit);
+        } else {
+            // already released for us, or pressed before we started reading
+            if (!(down.load() & downBit))
+                return;
+            down.fetchAndAndRelaxed(~downBit);
         }
     }
 
-    if (m_capsLock && map_withmod && (map_withmod->flags & QBsdKeyboardMap::IsLetter))
+    if (filterHotkey(keycode, pressed, autorepeat))
+        return;
+
+    if (filterComposedKey(keycode, pressed, autorepeat))
+        return;
+
+    bool first_press = pressed && !autorepeat;
+
+    if (!keymap)
+        keymap = m_keymap.loadAcquire();
+
+    quint16 modifiers = QBsdKeyboardMap::foldModifiers(m_modifiers);
+
+    // get a specific and plain mapping for the keycode and the current modifiers
+    const QBsdKeyboardMap::Mapping *map_plain = keymap->mapping(keycode, QBsdKeyboardMap::ModPlain);
+
+    // CapsShift is a momentary CapsLock
+    if (m_capsLock != bool(m_modifiers & QBsdKeyboardMap::ModCapsShift)
+            && map_plain && (map_plain->flags & QBsdKeyboardMap::IsLetter))
         modifiers ^= QBsdKeyboardMap::ModShift;
 
-#ifdef QT_BSD_KEYBOARD_DEBUG
-    qWarning("Processing key event: keycode=%3d, modifiers=%02x pressed=%d, autorepeat=%d  |  plain=%jd, withmod=%jd, size=%d", \
-             keycode, modifiers, pressed ? 1 : 0, autorepeat ? 1 : 0, \
-             map_plain ? (uintptr_t)(map_plain - m_keymap) : -1, \
-             map_withmod ? (uintptr_t)(map_withmod - m_keymap) : -1, \
-             m_keymapSize);
-#endif
+    const QBsdKeyboardMap::Mapping *map_withmod = keymap->mapping(keycode, modifiers);
+
+    qCDebug(qLcBsdKeyboard, "Processing key event: keycode=%3d, modifiers=%04x pressed=%d, autorepeat=%d  |  plain=%jd, withmod=%jd, size=%d",
+            keycode, modifiers, pressed ? 1 : 0, autorepeat ? 1 : 0,
+            map_plain ? (intmax_t)(map_plain - keymap->mappings()) : -1,
+            map_withmod ? (intmax_t)(map_withmod - keymap->mappings()) : -1,
+            keymap->size());
 
     const QBsdKeyboardMap::Mapping *it = map_withmod ? map_withmod : map_plain;
+    QBSD_TRACE_KEYMAP_LOOKUP(keycode, modifiers, it ? int(it->qtcode) : -1);
 
     if (!it) {
-#ifdef QT_BSD_KEYBOARD_DEBUG
         // we couldn't even find a plain mapping
-        qWarning("Could not find a suitable mapping for keycode: %3d, modifiers: %02x", keycode, modifiers);
-#endif
+        m_stats->add(QBsdInputStats::KeymapMisses);
+        qCDebug(qLcBsdKeyboard, "Could not find a suitable mapping for keycode: %3d, modifiers: %04x", keycode, modifiers);
         return;
     }
 
+    const QBsdKeymap::KeyRecord &record = keymap->record(it);
+
     bool skip = false;
+    bool rewritten = false;
     quint16 unicode = it->unicode;
-    quint32 qtcode = it->qtcode;
+    const quint32 qtcode = it->qtcode;
+    int key = record.key;
 
     if ((it->flags & QBsdKeyboardMap::IsModifier) && it->special) {
         // this is a modifier, i.e. Shift, Alt, ...
         if (pressed)
-            m_modifiers |= quint8(it->special);
+            m_modifiers |= it->special;
         else
-            m_modifiers &= ~quint8(it->special);
+            m_modifiers &= ~it->special;
+        publishModifiers();
+    } else if (it->flags & QBsdKeyboardMap::IsSystem) {
+        // console switching, the key itself is never delivered
+        if (first_press) {
+            if (it->special >= QBsdKeyboardMap::SystemConsoleFirst && it->special <= QBsdKeyboardMap::SystemConsoleLast)
+                switchConsole((it->special & QBsdKeyboardMap::SystemConsoleMask) + 1);
+            else if (it->special == QBsdKeyboardMap::SystemConsolePrevious)
+                switchConsole(m_vtIndex - 1);
+            else if (it->special == QBsdKeyboardMap::SystemConsoleNext)
+                switchConsole(m_vtIndex + 1);
+        }
+        skip = true;
     } else if (qtcode >= Qt::Key_CapsLock && qtcode <= Qt::Key_ScrollLock) {
         // (Caps|Num|Scroll)Lock
         if (first_press) {
@@ -272,77 +716,273 @@ void QBsdKeyboardHandler::processKeycode(quint16 keycode, bool pressed, bool aut
             default:
                 break;
             }
+            publishModifiers();
+        }
+    } else if (qtcode == Qt::Key_Multi_key) {
+        // the Compose key was pressed
+        if (first_press)
+            m_composing = 2;
+        skip = true;
+    } else if (qtcode >= Qt::Key_Dead_Grave && qtcode <= Qt::Key_Dead_Horn) {
+        // dead keys
+        if (first_press && m_composing == 1 && m_deadUnicode == unicode) {
+            // pressed twice -> output the accent itself
+            m_composing = 0;
+            key = Qt::Key_unknown;
+            rewritten = true;
+        } else if (first_press && unicode != 0xffff) {
+            m_deadUnicode = unicode;
+            m_deadKeycode = keycode;
+            // as they would have been reported for the key, see below
+            m_deadModifiers = record.modifiers;
+            if (it != map_withmod || record.modifiers == Qt::NoModifier)
+                m_deadModifiers |= keymap->qtModifiers(modifiers);
+            m_composing = 1;
+            skip = true;
+        } else {
+            skip = true;
         }
     }
 
     if (!skip) {
         // a normal key was pressed
-        const int modmask = Qt::ShiftModifier | Qt::ControlModifier | Qt::AltModifier | Qt::MetaModifier | Qt::KeypadModifier;
+        Qt::KeyboardModifiers qtmods = record.modifiers;
+        QString text = record.text;
 
         // we couldn't find a specific mapping for the current modifiers,
         // or that mapping didn't have special modifiers:
         // so just report the plain mapping with additional modifiers.
-        if ((it == map_plain && it != map_withmod) ||
-            (map_withmod && !(map_withmod->qtcode & modmask))) {
-            qtcode |= QBsdKeyboardHandler::toQtModifiers(modifiers);
+        if (it != map_withmod || record.modifiers == Qt::NoModifier)
+            qtmods |= keymap->qtModifiers(modifiers);
+
+        qCDebug(qLcBsdKeyboard, "Processing: uni=%04x, qt=%08x, qtmod=%08x", unicode, key, int(qtmods));
+        if (m_composing == 2 && first_press && !(it->flags & QBsdKeyboardMap::IsModifier)) {
+            // the last key press was the Compose key
+            if (unicode != 0xffff && keymap->lookupCompose(unicode, 0) >= 0) {
+                // this symbol starts a sequence -> continue as if it was a dead key
+                m_deadUnicode = unicode;
+                m_deadKeycode = keycode;
+                m_deadModifiers = qtmods;
+                m_composing = 1;
+                if (keycode < QBsdKeyboardMap::KeycodeCount)
+                    m_swallowedKeys[keycode / 32] |= 1u << (keycode % 32);
+                return;
+            }
+            m_composing = 0;
+        } else if (m_composing == 1 && first_press && !(it->flags & QBsdKeyboardMap::IsModifier)) {
+            // the last key press was a dead key
+            int composed = (unicode != 0xffff) ? keymap->lookupCompose(m_deadUnicode, unicode) : -1;
+            if (composed >= 0 && composed != 0xffff) {
+                unicode = composed;
+                key = Qt::Key_unknown;
+                text = keymap->text(unicode);
+                rewritten = true;
+            } else {
+                // no such sequence -> the accent on its own, then the key as typed
+                const QString accent = keymap->text(m_deadUnicode);
+                processKeyEvent(m_deadKeycode, accent, Qt::Key_unknown, m_deadModifiers, true, false);
+                processKeyEvent(m_deadKeycode, accent, Qt::Key_unknown, m_deadModifiers, false, false);
+            }
+            m_composing = 0;
         }
 
-#ifdef QT_BSD_KEYBOARD_DEBUG
-        qWarning("Processing: uni=%04x, qt=%08x, qtmod=%08x", unicode, qtcode & ~modmask, (qtcode & modmask));
-#endif
         //If NumLockOff and keypad key pressed remap event sent
-        if (!m_numLock &&
-             (qtcode & Qt::KeypadModifier)) {
-            unicode = 0xffff;
-            int oldMask = (qtcode & modmask);
-            switch (qtcode & ~modmask) {
-            case Qt::Key_7: //7 --> Home
-                qtcode = Qt::Key_Home;
-                break;
-            case Qt::Key_8: //8 --> Up
-                qtcode = Qt::Key_Up;
-                break;
-            case Qt::Key_9: //9 --> PgUp
-                qtcode = Qt::Key_PageUp;
-                break;
-            case Qt::Key_4: //4 --> Left
-                qtcode = Qt::Key_Left;
-                break;
-            case Qt::Key_5: //5 --> Clear
-                qtcode = Qt::Key_Clear;
-                break;
-            case Qt::Key_6: //6 --> right
-                qtcode = Qt::Key_Right;
-                break;
-            case Qt::Key_1: //1 --> End
-                qtcode = Qt::Key_End;
-                break;
-            case Qt::Key_2: //2 --> Down
-                qtcode = Qt::Key_Down;
-                break;
-            case Qt::Key_3: //3 --> PgDn
-                qtcode = Qt::Key_PageDown;
-                break;
-            case Qt::Key_0: //0 --> Ins
-                qtcode = Qt::Key_Insert;
-                break;
-            case Qt::Key_Period: //. --> Del
-                qtcode = Qt::Key_Delete;
+        if (!m_numLock && (qtmods & Qt::KeypadModifier)) {
+            if (key == record.key)
+                key = record.numLockOffKey;
+            text = QString();
+        }
+
+        if (rewritten && keycode < QBsdKeyboardMap::KeycodeCount) {
+            const ComposedKey composedKey = { key, text, qtmods };
+            m_composedKeys.insert(keycode, composedKey);
+        }
+
+        // send the result to the server
+        processKeyEvent(keycode, text, key, qtmods, pressed, autorepeat);
+    }
+}
+
+void QBsdKeyboardHandler::focusWindowChanged()
+{
+    // A key held across a focus change would go on repeating into the new
+    // window, which never saw it pressed. Release it there instead; when
+    // the key repeats, the new window gets a fresh press. Held modifiers
+    // stay, they apply to whatever window has focus.
+    if (m_hidRepeatTimer)
+        m_hidRepeatTimer->stop();
+    releaseKeys(m_keymap.loadAcquire(), true);
+}
+
+bool QBsdKeyboardHandler::filterComposedKey(quint16 keycode, bool pressed, bool autorepeat)
+{
+    if (keycode >= QBsdKeyboardMap::KeycodeCount)
+        return false;
+
+    quint32 &swallowed = m_swallowedKeys[keycode / 32];
+    const quint32 swallowedBit = 1u << (keycode % 32);
+
+    if (pressed && !autorepeat) {
+        // a new press is decoded afresh
+        swallowed &= ~swallowedBit;
+        m_composedKeys.remove(keycode);
+        return false;
+    }
+
+    if (swallowed & swallowedBit) {
+        if (!pressed)
+            swallowed &= ~swallowedBit;
+        return true;
+    }
+
+    QHash<quint16, ComposedKey>::iterator it = m_composedKeys.find(keycode);
+    if (it == m_composedKeys.end())
+        return false;
+
+    // repeat or release what the press turned into
+    const ComposedKey composedKey = it.value();
+    if (!pressed)
+        m_composedKeys.erase(it);
+    processKeyEvent(keycode, composedKey.text, composedKey.qtcode, composedKey.modifiers, pressed, autorepeat);
+    return true;
+}
+
+void QBsdKeyboardHandler::finishBurst()
+{
+    if (!m_burstDetector || !m_burstDetector->isPending())
+        return;
+
+    m_burstTimer->stop();
+
+    QVector<QBsdBurstDetector::Key> replay;
+    QVector<int> held;
+    const QString scanned = m_burstDetector->finish(&replay, &held);
+
+    // the presses went into the text, so must their releases
+    for (int keycode : qAsConst(held)) {
+        if (keycode < QBsdKeyboardMap::KeycodeCount)
+            m_swallowedKeys[keycode / 32] |= 1u << (keycode % 32);
+    }
+
+    if (!scanned.isEmpty()) {
+        emit scannedText(scanned);
+
+        // queued like the keys, so it lands between the keys before the
+        // burst and the ones replayed after it
+        if (m_burstCommit)
+            m_eventQueue->postCommit(scanned);
+    }
+
+    for (const QBsdBurstDetector::Key &key : qAsConst(replay))
+        deliverKeyEvent(key.nativecode, key.text, key.qtcode, key.modifiers, key.isPress, key.autoRepeat);
+}
+
+bool QBsdKeyboardHandler::filterHotkey(quint16 keycode, bool pressed, bool autorepeat)
+{
+    if (keycode >= QBsdKeyboardMap::KeycodeCount)
+        return false;
+
+    quint32 &down = m_hotkeyKeysDown[keycode / 32];
+    const quint32 downBit = 1u << (keycode % 32);
+
+    if (!pressed || autorepeat) {
+        if (!(down & downBit))
+            return false;
+        if (!pressed)
+            down &= ~downBit;
+        return true;
+    }
+
+    const quint16 modifiers = QBsdKeyboardMap::foldModifiers(m_modifiers);
+    const int bit = keycode * QBsdKeyboardMap::LookupLevels + QBsdKeyboardMap::lookupLevel(modifiers);
+    if (!(m_hotkeyBits[bit / 32].loadAcquire() & (1u << (bit % 32))))
+        return false;
+
+    int id = -1;
+    {
+        QMutexLocker locker(&m_hotkeysLock);
+        for (int i = 0; i < m_hotkeys.size(); ++i) {
+            const Hotkey &hotkey = m_hotkeys.at(i);
+            if (hotkey.keycode == keycode && hotkey.modifiers == modifiers) {
+                id = hotkey.id;
                 break;
             }
-            qtcode |= oldMask;
         }
+    }
 
-        // send the result to the server
-        processKeyEvent(keycode, unicode, qtcode & ~modmask, Qt::KeyboardModifiers(qtcode & modmask), pressed, autorepeat);
+    // unregistered in the meantime
+    if (id < 0)
+        return false;
+
+    down |= downBit;
+    emit hotkeyActivated(id);
+    return true;
+}
+
+int QBsdKeyboardHandler::registerHotkey(int keycode, int modifiers)
+{
+    if (keycode < 0 || keycode >= QBsdKeyboardMap::KeycodeCount)
+        return -1;
+
+    Hotkey hotkey;
+    hotkey.keycode = quint16(keycode);
+    hotkey.modifiers = QBsdKeyboardMap::foldModifiers(quint16(modifiers));
+
+    const int bit = keycode * QBsdKeyboardMap::LookupLevels + QBsdKeyboardMap::lookupLevel(hotkey.modifiers);
+
+    QMutexLocker locker(&m_hotkeysLock);
+    hotkey.id = ++m_lastHotkeyId;
+    m_hotkeys.append(hotkey);
+    m_hotkeyBits[bit / 32].fetchAndOrRelease(1u << (bit % 32));
+
+    return hotkey.id;
+}
+
+void QBsdKeyboardHandler::unregisterHotkey(int id)
+{
+    QMutexLocker locker(&m_hotkeysLock);
+
+    for (int i = 0; i < m_hotkeys.size(); ++i) {
+        const Hotkey hotkey = m_hotkeys.at(i);
+        if (hotkey.id != id)
+            continue;
+
+        m_hotkeys.remove(i);
+
+        // keep the bit while another hotkey still uses the same combination
+        for (int j = 0; j < m_hotkeys.size(); ++j) {
+            if (m_hotkeys.at(j).keycode == hotkey.keycode && m_hotkeys.at(j).modifiers == hotkey.modifiers)
+                return;
+        }
+
+        const int bit = hotkey.keycode * QBsdKeyboardMap::LookupLevels + QBsdKeyboardMap::lookupLevel(hotkey.modifiers);
+        m_hotkeyBits[bit / 32].fetchAndAndRelease(~(1u << (bit % 32)));
+        return;
     }
 }
 
 void QBsdKeyboardHandler::switchLed(int led, bool state)
 {
-#ifdef QT_BSD_KEYBOARD_DEBUG
-    qWarning() << "switchLed" << led << state;
-#endif
+    QBSD_TRACE_LED(led, state);
+    qCDebug(qLcBsdKeyboard) << "switchLed" << led << state;
+    if (m_hidDecoder) {
+        const quint8 hidLed = (led == LED_NUM) ? HidLedNumLock
+                            : (led == LED_CAP) ? HidLedCapsLock : HidLedScrollLock;
+        if (state)
+            m_hidLeds |= hidLed;
+        else
+            m_hidLeds &= ~hidLed;
+        m_stats->add(QBsdInputStats::LedIoctls);
+        // fails quietly for recordings and read-only devices
+        QT_WRITE(m_fd, &m_hidLeds, sizeof(m_hidLeds));
+        return;
+    }
+
+    // no LEDs on a plain tty
+    if (m_origKbdMode < 0)
+        return;
+
+    m_stats->add(QBsdInputStats::LedIoctls);
     int leds = 0;
     if (ioctl(m_fd, KDGETLED, &leds) < 0) {
         qWarning("switchLed: Failed to query led states.");
@@ -354,31 +994,32 @@ void QBsdKeyboardHandler::switchLed(int led, bool state)
     else
         leds &= ~led;
 
+    m_stats->add(QBsdInputStats::LedIoctls);
     if (ioctl(m_fd, KDSETLED, leds) < 0) {
         qWarning("switchLed: Failed to set led states.");
         return;
     }
 }
 
-void QBsdKeyboardHandler::resetKeymap()
+void QBsdKeyboardHandler::syncLockStates()
 {
-#ifdef QT_BSD_KEYBOARD_DEBUG
-    qWarning() << "Unload current keymap and restore built-in";
-#endif
-
-    if (m_keymap && m_keymap != s_keymapDefault)
-        delete [] m_keymap;
-
-    m_keymap = s_keymapDefault;
-    m_keymapSize = sizeof(s_keymapDefault) / sizeof(s_keymapDefault[0]);
-
-    // reset state, so we could switch keymaps at runtime
-    m_modifiers = 0;
     m_capsLock = false;
     m_numLock = false;
     m_scrollLock = false;
 
+    // a HID keyboard has no state of its own, start with all locks off
+    if (m_hidDecoder) {
+        m_hidLeds = 0;
+        m_stats->add(QBsdInputStats::LedIoctls);
+        QT_WRITE(m_fd, &m_hidLeds, sizeof(m_hidLeds));
+        return;
+    }
+
+    if (m_origKbdMode < 0)
+        return;
+
     //Set locks according to keyboard leds
+    m_stats->add(QBsdInputStats::LedIoctls);
     int leds = 0;
     if (ioctl(m_fd, KDGETLED, &leds) < 0) {
         qWarning("Failed to query led states. Settings numlock & capslock off");
@@ -392,8 +1033,207 @@ void QBsdKeyboardHandler::resetKeymap()
             m_numLock = true;
         if ((leds & LED_SCR) > 0)
             m_scrollLock = true;
-#ifdef QT_BSD_KEYBOARD_DEBUG
-        qWarning("numlock=%d , capslock=%d, scrolllock=%d",m_numLock, m_capsLock, m_scrollLock);
-#endif
+        qCDebug(qLcBsdKeyboard, "numlock=%d , capslock=%d, scrolllock=%d", m_numLock, m_capsLock, m_scrollLock);
     }
 }
+
+// also publishes the lock states to the shared memory page
+void QBsdKeyboardHandler::publishModifiers()
+{
+    const Qt::KeyboardModifiers modifiers = toQtModifiers(m_modifiers);
+    QAtomicInt &published = m_seat ? m_seat->keyboardModifiers : m_inputState->keyboardModifiers;
+    published.storeRelease(int(modifiers));
+
+    quint32 locks = 0;
+    if (m_capsLock)
+        locks |= QBsdSharedInputPage::CapsLock;
+    if (m_numLock)
+        locks |= QBsdSharedInputPage::NumLock;
+    if (m_scrollLock)
+        locks |= QBsdSharedInputPage::ScrollLock;
+    m_inputState->shared.publishKeyboard(quint32(modifiers), locks);
+}
+
+bool QBsdKeyboardHandler::loadKeymap(const QString &file)
+{
+    QBsdKeymap *keymap = QBsdKeymap::load(file);
+    if (!keymap)
+        return false;
+
+    setKeymap(keymap);
+    return true;
+}
+
+void QBsdKeyboardHandler::resetKeymap()
+{
+    qCDebug(qLcBsdKeyboard) << "Unload current keymap and restore built-in";
+
+    setKeymap(new QBsdKeymap);
+}
+
+void QBsdKeyboardHandler::setKeymap(QBsdKeymap *keymap)
+{
+    // Held modifiers, lock states and LEDs are deliberately left alone:
+    // the next key is decoded with the new keymap and the current state.
+    // Other held keys are released in releaseRetiredKeymaps().
+    QBsdKeymap *old = m_keymap.fetchAndStoreOrdered(keymap);
+
+    QMutexLocker locker(&m_retiredKeymapsLock);
+    m_retiredKeymaps.append(old);
+    locker.unlock();
+
+    QMetaObject::invokeMethod(this, "releaseRetiredKeymaps", Qt::QueuedConnection);
+}
+
+void QBsdKeyboardHandler::releaseRetiredKeymaps()
+{
+    QMutexLocker locker(&m_retiredKeymapsLock);
+    const QList<QBsdKeymap *> retired = m_retiredKeymaps;
+    m_retiredKeymaps.clear();
+    locker.unlock();
+
+    // keys pressed under the old keymap go up under it too, so the
+    // application sees the same Qt keys released
+    if (!retired.isEmpty() && m_fd >= 0)
+        releaseKeys(retired.first(), true);
+
+    qDeleteAll(retired);
+}
+
+void QBsdKeyboardHandler::setupVtSwitching()
+{
+    struct vt_mode mode;
+    if (ioctl(m_fd, VT_GETMODE, &mode) < 0)
+        return;
+
+    if (s_vtSignalFd[0] != -1) {
+        qWarning("VT switching is already handled by another keyboard handler");
+        return;
+    }
+
+    if (::socketpair(AF_UNIX, SOCK_STREAM, 0, s_vtSignalFd)) {
+        qErrnoWarning(errno, "socketpair() failed");
+        s_vtSignalFd[0] = s_vtSignalFd[1] = -1;
+        return;
+    }
+    fcntl(s_vtSignalFd[0], F_SETFL, O_NONBLOCK);
+    fcntl(s_vtSignalFd[1], F_SETFL, O_NONBLOCK);
+
+    struct sigaction sa;
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = vtSignalHandler;
+    sa.sa_flags = SA_RESTART;
+    sigemptyset(&sa.sa_mask);
+    sigaction(SIGUSR1, &sa, &s_origRelSigAction);
+    sigaction(SIGUSR2, &sa, &s_origAcqSigAction);
+
+    m_origVtMode = new struct vt_mode;
+    *m_origVtMode = mode;
+
+    mode.mode = VT_PROCESS;
+    mode.relsig = SIGUSR1;
+    mode.acqsig = SIGUSR2;
+    mode.frsig = SIGUSR1;
+    if (ioctl(m_fd, VT_SETMODE, &mode) < 0) {
+        qErrnoWarning(errno, "ioctl(VT_SETMODE) failed");
+        revertVtSwitching();
+        return;
+    }
+
+    m_vtNotifier = new QSocketNotifier(s_vtSignalFd[1], QSocketNotifier::Read, this);
+    connect(m_vtNotifier, SIGNAL(activated(int)), this, SLOT(handleVtSignal()));
+}
+
+void QBsdKeyboardHandler::revertVtSwitching()
+{
+    if (s_vtSignalFd[0] == -1 || !m_origVtMode)
+        return;
+
+    ioctl(m_fd, VT_SETMODE, m_origVtMode);
+    delete m_origVtMode;
+    m_origVtMode = 0;
+
+    sigaction(SIGUSR1, &s_origRelSigAction, 0);
+    sigaction(SIGUSR2, &s_origAcqSigAction, 0);
+
+    delete m_vtNotifier;
+    m_vtNotifier = 0;
+    close(s_vtSignalFd[0]);
+    close(s_vtSignalFd[1]);
+    s_vtSignalFd[0] = s_vtSignalFd[1] = -1;
+}
+
+void QBsdKeyboardHandler::switchConsole(int vt)
+{
+    if (vt < 1 || vt == m_vtIndex)
+        return;
+
+    if (ioctl(m_fd, VT_ACTIVATE, (intptr_t)vt) < 0)
+        qErrnoWarning(errno, "ioctl(VT_ACTIVATE, %d) failed", vt);
+}
+
+void QBsdKeyboardHandler::handleVtSignal()
+{
+    char signo;
+    while (QT_READ(s_vtSignalFd[1], &signo, sizeof(signo)) == sizeof(signo)) {
+        if (signo == SIGUSR1)
+            releaseVt();
+        else if (signo == SIGUSR2)
+            acquireVt();
+    }
+}
+
+void QBsdKeyboardHandler::releaseVt()
+{
+    if (!m_active)
+        return;
+
+    // stop reading until the terminal is ours again; nothing typed
+    // in the meantime is meant for us
+    m_notifier->setEnabled(false);
+    m_active = false;
+
+    resetKeyState();
+
+    if (ioctl(m_fd, VT_RELDISP, (intptr_t)1) < 0)
+        qErrnoWarning(errno, "ioctl(VT_RELDISP) failed");
+
+    emit activeChanged(false);
+}
+
+void QBsdKeyboardHandler::acquireVt()
+{
+    if (ioctl(m_fd, VT_RELDISP, (intptr_t)VT_ACKACQ) < 0)
+        qErrnoWarning(errno, "ioctl(VT_RELDISP, VT_ACKACQ) failed");
+
+    if (m_active)
+        return;
+
+    tcflush(m_fd, TCIFLUSH);
+    ioctl(m_fd, KDSKBMODE, K_CODE);
+
+    // the other terminal may have toggled the locks
+    syncLockStates();
+
+    m_active = true;
+    m_notifier->setEnabled(true);
+
+    emit activeChanged(true);
+}
+
+void QBsdKeyboardHandler::detachFromThread()
+{
+    m_notifier.reset();
+    moveToThread(m_thread->thread());
+}
+
+void QBsdKeyboardHandler::keymapFileChanged(const QString &path)
+{
+    // editors tend to replace the file, which drops it from the watch list
+    if (!m_keymapWatcher->files().contains(path) && QFile::exists(path))
+        m_keymapWatcher->addPath(path);
+
+    loadKeymap(path);
+}
+
+QT_END_NAMESPACE
@@ -34,51 +34,33 @@
 #define QBSDKEYBOARD_H
 
 #include <qobject.h>
-#include <QDataStream>
+#include <QElapsedTimer>
+#include <QAtomicInteger>
+#include <QAtomicPointer>
+#include <QHash>
+#include <QList>
+#include <QMutex>
+#include <QVector>
+
+#include "qbsdhidkeyboard.h"
+#include "qbsdkeymap.h"
+#include "qbsdinputstate_p.h"
 
 QT_BEGIN_NAMESPACE
 
 class QSocketNotifier;
+class QFileSystemWatcher;
+class QThread;
+class QTimer;
+class QBsdDeviceMonitor;
+class QBsdBurstDetector;
+class QBsdEventQueue;
+class QBsdInjectionServer;
+class QBsdSeat;
+struct QBsdInputStats;
 
 struct termios;
-
-namespace QBsdKeyboardMap {
-    const quint32 FileMagic = 0x514d4150; // 'QMAP'
-
-    struct Mapping {
-        quint16 keycode;
-        quint16 unicode;
-        quint32 qtcode;
-        quint8 modifiers;
-        quint8 flags;
-        quint16 special;
-
-    };
-
-    enum Flags {
-        NoFlags    = 0x00,
-        IsLetter   = 0x01,
-        IsModifier = 0x02
-    };
-
-    enum Modifiers {
-        ModPlain   = 0x00,
-        ModShift   = 0x01,
-        ModAltGr   = 0x02,
-        ModControl = 0x04,
-        ModAlt     = 0x08,
-        ModShiftL  = 0x10,
-        ModShiftR  = 0x20,
-        ModCtrlL   = 0x40,
-        ModCtrlR   = 0x80
-        // ModCapsShift = 0x100, // not supported!
-    };
-}
-
-inline QDataStream &operator>>(QDataStream &ds, QBsdKeyboardMap::Mapping &m)
-{
-    return ds >> m.keycode >> m.unicode >> m.qtcode >> m.modifiers >> m.flags >> m.special;
-}
+struct vt_mode;
 
 class QBsdKeyboardHandler : public QObject
 {
@@ -88,49 +70,189 @@ public:
     explicit QBsdKeyboardHandler(const QString &key, const QString &specification);
     ~QBsdKeyboardHandler() override;
 
-    static Qt::KeyboardModifiers toQtModifiers(quint8 mod)
+    static Qt::KeyboardModifiers toQtModifiers(quint16 mod)
     {
-        Qt::KeyboardModifiers qtmod = Qt::NoModifier;
+        return QBsdKeyboardMap::toQtModifiers(mod);
+    }
 
-        if (mod & (QBsdKeyboardMap::ModShift | QBsdKeyboardMap::ModShiftL | QBsdKeyboardMap::ModShiftR))
-            qtmod |= Qt::ShiftModifier;
-        if (mod & (QBsdKeyboardMap::ModControl | QBsdKeyboardMap::ModCtrlL | QBsdKeyboardMap::ModCtrlR))
-            qtmod |= Qt::ControlModifier;
-        if (mod & QBsdKeyboardMap::ModAlt)
-            qtmod |= Qt::AltModifier;
+    // Applications reach the handlers through the application object, with
+    // no need for this header; the calls and connections below go through
+    // the meta-object system:
+    //
+    //     const QVariantList handlers = qApp->property("bsdKeyboardHandlers").toList();
+    //     QObject *keyboard = handlers.value(0).value<QObject *>();
+    //     int id = -1;
+    //     QMetaObject::invokeMethod(keyboard, "registerHotkey", Qt::DirectConnection,
+    //                               Q_RETURN_ARG(int, id), Q_ARG(int, keycode), Q_ARG(int, modifiers));
+    //     QObject::connect(keyboard, SIGNAL(hotkeyActivated(int)), receiver, SLOT(...),
+    //                      Qt::DirectConnection);
+    //     QObject::connect(keyboard, SIGNAL(scannedText(QString)), receiver, SLOT(...));
 
-        return qtmod;
-    }
+    // Global hotkeys are matched in the decode loop, before the key enters
+    // Qt's event delivery, and swallowed. modifiers is a QBsdKeyboardMap::Modifiers
+    // mask (per-side bits are folded). Both calls are thread-safe.
+    Q_INVOKABLE int registerHotkey(int keycode, int modifiers);
+    Q_INVOKABLE void unregisterHotkey(int id);
+
+    // Whether the key with this console keycode is held, as far as the
+    // application has been told. Thread-safe.
+    Q_INVOKABLE bool isKeyDown(int keycode) const;
+
+signals:
+    // Emitted from the thread reading the device. Connect with
+    // Qt::DirectConnection to not depend on the GUI thread at all.
+    void hotkeyActivated(int id);
+
+    // the virtual terminal we read from was switched away from or back to
+    void activeChanged(bool active);
+
+    // a barcode scan recognized by its timing (spec option "scanner=<ms>"),
+    // emitted from the thread reading the device
+    void scannedText(const QString &text);
 
 protected:
     void switchLed(int led, bool state);
-    void processKeycode(quint16 keycode, bool pressed, bool autorepeat);
-    void processKeyEvent(int nativecode, int unicode, int qtcode,
+    void processKeycode(quint16 keycode, bool pressed, bool autorepeat, const QBsdKeymap *keymap = 0);
+    void releaseKeys(const QBsdKeymap *keymap, bool keepModifiers);
+    void processKeyEvent(int nativecode, const QString &text, int qtcode,
+                         Qt::KeyboardModifiers modifiers, bool isPress, bool autoRepeat);
+    void deliverKeyEvent(int nativecode, const QString &text, int qtcode,
                          Qt::KeyboardModifiers modifiers, bool isPress, bool autoRepeat);
     void revertTTYSettings();
+    bool setupConsole(const QByteArray &device);
+    void processInput(QBsdHidReportDecoder *hidDecoder, const quint8 *data, int size);
+    void processHidByte(QBsdHidReportDecoder *hidDecoder, quint8 byte);
+    void processHidEvents(const QBsdHidReportDecoder::KeyEvent *events, int count);
+    void resetKeyState();
+    void syncLockStates();
+    void publishModifiers();
+    void setKeymap(QBsdKeymap *keymap);
+    bool filterHotkey(quint16 keycode, bool pressed, bool autorepeat);
+    bool filterComposedKey(quint16 keycode, bool pressed, bool autorepeat);
+    void setupVtSwitching();
+    void revertVtSwitching();
+    void switchConsole(int vt);
+    void releaseVt();
+    void acquireVt();
 
-private slots:
+public slots:
+    // both are safe to call from any thread
+    bool loadKeymap(const QString &file);
     void resetKeymap();
+
+private slots:
     void readKeyboardData();
+    void openDevice();
+    void closeDevice();
+    void keymapFileChanged(const QString &path);
+    void releaseRetiredKeymaps();
+    void detachFromThread();
+    void handleVtSignal();
+    void repeatHidKey();
+    void finishBurst();
+    void injectInput(int client, const QByteArray &data);
+    void injectionClientClosed(int client);
+    void focusWindowChanged();
 
 private:
+    struct Hotkey {
+        int id;
+        quint16 keycode;
+        quint16 modifiers;
+    };
+
     QScopedPointer<QSocketNotifier> m_notifier;
     struct termios *m_kbdOrigTty;
-    int m_origKbdMode;
+    int m_origKbdMode;      // -1 if the device is not a console
     int m_fd;
     bool m_shouldClose;
-    QString m_spec;
+    QByteArray m_device;    // empty for stdin
+    bool m_vtSwitching;
+    bool m_rawTty;          // spec option "raw": a tty sending K_CODE bytes, not a console
 
     // keymap handling
-    quint8 m_modifiers;
+    quint16 m_modifiers;
     bool m_capsLock;
     bool m_numLock;
     bool m_scrollLock;
 
-    const QBsdKeyboardMap::Mapping *m_keymap;
-    int m_keymapSize;
+    QBsdInputState *m_inputState;
+
+    // decode-time state, only touched from the handler's own thread
+    int m_composing; // 0 = idle, 1 = after a dead key, 2 = after the Compose key
+    quint16 m_deadUnicode;
+    quint16 m_deadKeycode;
+    Qt::KeyboardModifiers m_deadModifiers;
+
+    // Keys whose press a compose sequence or a scan swallowed, or a compose
+    // sequence rewrote, so their repeats and release get the same treatment
+    // and stay balanced.
+    struct ComposedKey {
+        int qtcode;
+        QString text;
+        Qt::KeyboardModifiers modifiers;
+    };
+    quint32 m_swallowedKeys[QBsdKeyboardMap::KeycodeCount / 32];
+    QHash<quint16, ComposedKey> m_composedKeys;
+
+    // Published keymap. Replaced ones are kept on the retired list until the
+    // handler's event loop runs again, so a concurrent decode pass never sees
+    // a keymap being deleted under it.
+    QAtomicPointer<QBsdKeymap> m_keymap;
+    QMutex m_retiredKeymapsLock;
+    QList<QBsdKeymap *> m_retiredKeymaps;
+
+    QFileSystemWatcher *m_keymapWatcher;
+
+    // one bit per (keycode, lookup level) with a registered hotkey
+    QAtomicInteger<quint32> m_hotkeyBits[QBsdKeyboardMap::KeycodeCount * QBsdKeyboardMap::LookupLevels / 32];
+    QMutex m_hotkeysLock;
+    QVector<Hotkey> m_hotkeys;
+    int m_lastHotkeyId;
+    // keys whose press triggered a hotkey, so their repeats and release are swallowed too
+    quint32 m_hotkeyKeysDown[QBsdKeyboardMap::KeycodeCount / 32];
+
+    // every key pressed and not yet released, written by the decoder only
+    QAtomicInteger<quint32> m_keysDown[QBsdKeyboardMap::KeycodeCount / 32];
+
+    // VT_PROCESS mode switching, see setupVtSwitching()
+    struct vt_mode *m_origVtMode;
+    QSocketNotifier *m_vtNotifier;
+    int m_vtIndex;
+    bool m_active;
+
+    // optional dedicated reader thread (spec option "thread")
+    QThread *m_thread;
+
+    // USB HID boot protocol input (spec option "hid")
+    QScopedPointer<QBsdHidReportDecoder> m_hidDecoder;
+    QHash<int, QBsdHidReportDecoder *> m_injectHidDecoders; // per injection client, framed separately
+    quint8 m_hidLeds;
+    QTimer *m_hidRepeatTimer;
+    quint16 m_hidRepeatKeycode;
+
+    // spec option "hotplug": the device is opened whenever it is present
+    QBsdDeviceMonitor *m_monitor;
+    QTimer *m_openRetryTimer;
+    int m_openRetries;
+
+    // barcode scanner burst detection
+    QScopedPointer<QBsdBurstDetector> m_burstDetector;
+    QElapsedTimer m_burstClock;
+    QTimer *m_burstTimer;
+    bool m_burstCommit;     // deliver scans to the focus object, not only scannedText()
+
+    // holds and coalesces events while the GUI thread lags behind
+    QBsdEventQueue *m_eventQueue;
+
+    // spec option "inject=<socket>"
+    QBsdInjectionServer *m_injectionServer;
+
+    // spec options "seat=<name>" and "screen=<name|index>"
+    QBsdSeat *m_seat;
 
-    static const QBsdKeyboardMap::Mapping s_keymapDefault[];
+    // exported when QT_BSD_INPUT_METRICS is set
+    QBsdInputStats *m_stats;
 };
 
 QT_END_NAMESPACE
@@ -55,7 +55,7 @@ using namespace QBsdKeyboardMap;
 #define QALT(x)     ((x) | Qt::AltModifier)
 #define QKEYPAD(x)  ((x) | Qt::KeypadModifier)
 
-const QBsdKeyboardMap::Mapping QBsdKeyboardHandler::s_keymapDefault[] = {
+const QBsdKeyboardMap::Mapping QBsdKeymap::s_keymapDefault[] = {
     {   1, 0xffff, Qt::Key_Escape,              ModPlain,                        NoFlags, 0x0000 },
     {   2, 0x0031, Qt::Key_1,                   ModPlain,                        NoFlags, 0x0000 },
     {   2, 0x0021, Qt::Key_Exclam,              ModShift,                        NoFlags, 0x0000 },
@@ -267,7 +267,7 @@ const QBsdKeyboardMap::Mapping QBsdKeyboardHandler::s_keymapDefault[] = {
     {  27, 0x005d, QCTRL(Qt::Key_BracketRight), ModControl,                      NoFlags, 0x0000 },
     {  28, 0xffff, Qt::Key_Return,              ModPlain,                        NoFlags, 0x0000 },
     {  28, 0x006d, QCTRL(QALT(Qt::Key_M)),      ModAlt,                          NoFlags, 0x0000 },
-    {  29, 0xffff, Qt::Key_Control,             ModPlain,                        IsModifier, ModControl },
+    {  29, 0xffff, Qt::Key_Control,             ModPlain,                        IsModifier, ModCtrlL },
     {  30, 0x0061, Qt::Key_A,                   ModPlain,                        IsLetter, 0x0000 },
     {  30, 0x0041, Qt::Key_A,                   ModShift,                        IsLetter, 0x0000 },
     {  30, 0x0061, Qt::Key_A,                   ModAltGr,                        IsLetter, 0x0000 },
@@ -419,7 +419,7 @@ const QBsdKeyboardMap::Mapping QBsdKeyboardHandler::s_keymapDefault[] = {
     {  40, 0x0067, QCTRL(Qt::Key_G),            ModControl,                      NoFlags, 0x0000 },
     {  41, 0x0060, Qt::Key_QuoteLeft,           ModPlain,                        NoFlags, 0x0000 },
     {  41, 0x007e, Qt::Key_AsciiTilde,          ModShift,                        NoFlags, 0x0000 },
-    {  42, 0xffff, Qt::Key_Shift,               ModPlain,                        IsModifier, ModShift },
+    {  42, 0xffff, Qt::Key_Shift,               ModPlain,                        IsModifier, ModShiftL },
     {  43, 0x005c, Qt::Key_Backslash,           ModPlain,                        NoFlags, 0x0000 },
     {  43, 0x007c, Qt::Key_Bar,                 ModShift,                        NoFlags, 0x0000 },
     {  43, 0x005c, QCTRL(Qt::Key_Backslash),    ModControl,                      NoFlags, 0x0000 },
@@ -543,41 +543,51 @@ const QBsdKeyboardMap::Mapping QBsdKeyboardHandler::s_keymapDefault[] = {
     {  53, 0x002f, Qt::Key_Slash,               ModPlain,                        NoFlags, 0x0000 },
     {  53, 0x003f, Qt::Key_Question,            ModShift,                        NoFlags, 0x0000 },
     {  53, 0xffff, Qt::Key_Backspace,           ModControl,                      NoFlags, 0x0000 },
-    {  54, 0xffff, Qt::Key_Shift,               ModPlain,                        IsModifier, ModShift },
+    {  54, 0xffff, Qt::Key_Shift,               ModPlain,                        IsModifier, ModShiftR },
     {  55, 0x002a, QKEYPAD(Qt::Key_Asterisk),   ModPlain,                        NoFlags, 0x0000 },
-    {  56, 0xffff, Qt::Key_Alt,                 ModPlain,                        IsModifier, ModAlt },
+    {  56, 0xffff, Qt::Key_Alt,                 ModPlain,                        IsModifier, ModAltL },
     {  57, 0x0020, Qt::Key_Space,               ModPlain,                        NoFlags, 0x0000 },
     {  58, 0xffff, Qt::Key_CapsLock,            ModPlain,                        NoFlags, 0x0000 },
     {  59, 0xffff, Qt::Key_F1,                  ModPlain,                        NoFlags, 0x0000 },
     {  59, 0xffff, Qt::Key_F13,                 ModShift,                        NoFlags, 0x0000 },
     {  59, 0xffff, Qt::Key_F25,                 ModControl,                      NoFlags, 0x0000 },
+    {  59, 0xffff, Qt::Key_F1,                  ModControl | ModAlt,             IsSystem, 0x0100 },
     {  60, 0xffff, Qt::Key_F2,                  ModPlain,                        NoFlags, 0x0000 },
     {  60, 0xffff, Qt::Key_F14,                 ModShift,                        NoFlags, 0x0000 },
     {  60, 0xffff, Qt::Key_F26,                 ModControl,                      NoFlags, 0x0000 },
+    {  60, 0xffff, Qt::Key_F2,                  ModControl | ModAlt,             IsSystem, 0x0101 },
     {  61, 0xffff, Qt::Key_F3,                  ModPlain,                        NoFlags, 0x0000 },
     {  61, 0xffff, Qt::Key_F15,                 ModShift,                        NoFlags, 0x0000 },
     {  61, 0xffff, Qt::Key_F27,                 ModControl,                      NoFlags, 0x0000 },
+    {  61, 0xffff, Qt::Key_F3,                  ModControl | ModAlt,             IsSystem, 0x0102 },
     {  62, 0xffff, Qt::Key_F4,                  ModPlain,                        NoFlags, 0x0000 },
     {  62, 0xffff, Qt::Key_F16,                 ModShift,                        NoFlags, 0x0000 },
     {  62, 0xffff, Qt::Key_F28,                 ModControl,                      NoFlags, 0x0000 },
+    {  62, 0xffff, Qt::Key_F4,                  ModControl | ModAlt,             IsSystem, 0x0103 },
     {  63, 0xffff, Qt::Key_F5,                  ModPlain,                        NoFlags, 0x0000 },
     {  63, 0xffff, Qt::Key_F17,                 ModShift,                        NoFlags, 0x0000 },
     {  63, 0xffff, Qt::Key_F29,                 ModControl,                      NoFlags, 0x0000 },
+    {  63, 0xffff, Qt::Key_F5,                  ModControl | ModAlt,             IsSystem, 0x0104 },
     {  64, 0xffff, Qt::Key_F6,                  ModPlain,                        NoFlags, 0x0000 },
     {  64, 0xffff, Qt::Key_F18,                 ModShift,                        NoFlags, 0x0000 },
     {  64, 0xffff, Qt::Key_F30,                 ModControl,                      NoFlags, 0x0000 },
+    {  64, 0xffff, Qt::Key_F6,                  ModControl | ModAlt,             IsSystem, 0x0105 },
     {  65, 0xffff, Qt::Key_F7,                  ModPlain,                        NoFlags, 0x0000 },
     {  65, 0xffff, Qt::Key_F19,                 ModShift,                        NoFlags, 0x0000 },
     {  65, 0xffff, Qt::Key_F31,                 ModControl,                      NoFlags, 0x0000 },
+    {  65, 0xffff, Qt::Key_F7,                  ModControl | ModAlt,             IsSystem, 0x0106 },
     {  66, 0xffff, Qt::Key_F8,                  ModPlain,                        NoFlags, 0x0000 },
     {  66, 0xffff, Qt::Key_F20,                 ModShift,                        NoFlags, 0x0000 },
     {  66, 0xffff, Qt::Key_F32,                 ModControl,                      NoFlags, 0x0000 },
+    {  66, 0xffff, Qt::Key_F8,                  ModControl | ModAlt,             IsSystem, 0x0107 },
     {  67, 0xffff, Qt::Key_F9,                  ModPlain,                        NoFlags, 0x0000 },
     {  67, 0xffff, Qt::Key_F21,                 ModShift,                        NoFlags, 0x0000 },
     {  67, 0xffff, Qt::Key_F33,                 ModControl,                      NoFlags, 0x0000 },
+    {  67, 0xffff, Qt::Key_F9,                  ModControl | ModAlt,             IsSystem, 0x0108 },
     {  68, 0xffff, Qt::Key_F10,                 ModPlain,                        NoFlags, 0x0000 },
     {  68, 0xffff, Qt::Key_F22,                 ModShift,                        NoFlags, 0x0000 },
     {  68, 0xffff, Qt::Key_F34,                 ModControl,                      NoFlags, 0x0000 },
+    {  68, 0xffff, Qt::Key_F10,                 ModControl | ModAlt,             IsSystem, 0x0109 },
     {  69, 0xffff, Qt::Key_NumLock,             ModPlain,                        NoFlags, 0x0000 },
     {  70, 0xffff, Qt::Key_ScrollLock,          ModPlain,                        NoFlags, 0x0000 },
     {  70, 0xffff, Qt::Key_ScrollLock,          ModAlt,                          NoFlags, 0x0000 },
@@ -600,10 +610,12 @@ const QBsdKeyboardMap::Mapping QBsdKeyboardHandler::s_keymapDefault[] = {
     {  87, 0xffff, Qt::Key_F11,                 ModPlain,                        NoFlags, 0x0000 },
     {  87, 0xffff, Qt::Key_F23,                 ModShift,                        NoFlags, 0x0000 },
     {  87, 0xffff, Qt::Key_F35,                 ModControl,                      NoFlags, 0x0000 },
+    {  87, 0xffff, Qt::Key_F11,                 ModControl | ModAlt,             IsSystem, 0x010a },
     {  88, 0xffff, Qt::Key_F12,                 ModPlain,                        NoFlags, 0x0000 },
     {  88, 0xffff, Qt::Key_F24,                 ModShift,                        NoFlags, 0x0000 },
+    {  88, 0xffff, Qt::Key_F12,                 ModControl | ModAlt,             IsSystem, 0x010b },
     {  89, 0xffff, QKEYPAD(Qt::Key_Enter),      ModPlain,                        NoFlags, 0x0000 },
-    {  90, 0xffff, Qt::Key_Control,             ModPlain,                        IsModifier, ModControl },
+    {  90, 0xffff, Qt::Key_Control,             ModPlain,                        IsModifier, ModCtrlR },
     {  91, 0x002f, QKEYPAD(Qt::Key_Slash),      ModPlain,                        NoFlags, 0x0000 },
     {  92, 0x005c, QCTRL(Qt::Key_Backslash),    ModPlain,                        NoFlags, 0x0000 },
     {  93, 0xffff, Qt::Key_AltGr,               ModPlain,                        IsModifier, ModAltGr },
@@ -617,6 +629,100 @@ const QBsdKeyboardMap::Mapping QBsdKeyboardHandler::s_keymapDefault[] = {
     { 101, 0xffff, Qt::Key_PageDown,            ModPlain,                        NoFlags, 0x0000 },
     { 102, 0xffff, Qt::Key_Insert,              ModPlain,                        NoFlags, 0x0000 },
     { 103, 0xffff, Qt::Key_Delete,              ModPlain,                        NoFlags, 0x0000 },
+    { 105, 0xffff, Qt::Key_Meta,                ModPlain,                        IsModifier, ModMetaL },
+    { 106, 0xffff, Qt::Key_Meta,                ModPlain,                        IsModifier, ModMetaR },
+    { 107, 0xffff, Qt::Key_Menu,                ModPlain,                        NoFlags, 0x0000 },
+};
+
+const QBsdKeyboardMap::Composing QBsdKeymap::s_keycomposeDefault[] = {
+    { 0x0022, 0x0020, 0x0022 },
+    { 0x0022, 0x0041, 0x00c4 },
+    { 0x0022, 0x0045, 0x00cb },
+    { 0x0022, 0x0049, 0x00cf },
+    { 0x0022, 0x004f, 0x00d6 },
+    { 0x0022, 0x0055, 0x00dc },
+    { 0x0022, 0x0061, 0x00e4 },
+    { 0x0022, 0x0065, 0x00eb },
+    { 0x0022, 0x0069, 0x00ef },
+    { 0x0022, 0x006f, 0x00f6 },
+    { 0x0022, 0x0075, 0x00fc },
+    { 0x0022, 0x0079, 0x00ff },
+    { 0x0027, 0x0020, 0x0027 },
+    { 0x0027, 0x0041, 0x00c1 },
+    { 0x0027, 0x0045, 0x00c9 },
+    { 0x0027, 0x0049, 0x00cd },
+    { 0x0027, 0x004f, 0x00d3 },
+    { 0x0027, 0x0055, 0x00da },
+    { 0x0027, 0x0059, 0x00dd },
+    { 0x0027, 0x0061, 0x00e1 },
+    { 0x0027, 0x0065, 0x00e9 },
+    { 0x0027, 0x0069, 0x00ed },
+    { 0x0027, 0x006f, 0x00f3 },
+    { 0x0027, 0x0075, 0x00fa },
+    { 0x0027, 0x0079, 0x00fd },
+    { 0x002c, 0x0020, 0x002c },
+    { 0x002c, 0x0043, 0x00c7 },
+    { 0x002c, 0x0063, 0x00e7 },
+    { 0x005e, 0x0020, 0x005e },
+    { 0x005e, 0x0041, 0x00c2 },
+    { 0x005e, 0x0045, 0x00ca },
+    { 0x005e, 0x0049, 0x00ce },
+    { 0x005e, 0x004f, 0x00d4 },
+    { 0x005e, 0x0055, 0x00db },
+    { 0x005e, 0x0061, 0x00e2 },
+    { 0x005e, 0x0065, 0x00ea },
+    { 0x005e, 0x0069, 0x00ee },
+    { 0x005e, 0x006f, 0x00f4 },
+    { 0x005e, 0x0075, 0x00fb },
+    { 0x0060, 0x0020, 0x0060 },
+    { 0x0060, 0x0041, 0x00c0 },
+    { 0x0060, 0x0045, 0x00c8 },
+    { 0x0060, 0x0049, 0x00cc },
+    { 0x0060, 0x004f, 0x00d2 },
+    { 0x0060, 0x0055, 0x00d9 },
+    { 0x0060, 0x0061, 0x00e0 },
+    { 0x0060, 0x0065, 0x00e8 },
+    { 0x0060, 0x0069, 0x00ec },
+    { 0x0060, 0x006f, 0x00f2 },
+    { 0x0060, 0x0075, 0x00f9 },
+    { 0x007e, 0x0020, 0x007e },
+    { 0x007e, 0x0041, 0x00c3 },
+    { 0x007e, 0x004e, 0x00d1 },
+    { 0x007e, 0x004f, 0x00d5 },
+    { 0x007e, 0x0061, 0x00e3 },
+    { 0x007e, 0x006e, 0x00f1 },
+    { 0x007e, 0x006f, 0x00f5 },
+    { 0x00a8, 0x0020, 0x00a8 },
+    { 0x00a8, 0x0041, 0x00c4 },
+    { 0x00a8, 0x0045, 0x00cb },
+    { 0x00a8, 0x0049, 0x00cf },
+    { 0x00a8, 0x004f, 0x00d6 },
+    { 0x00a8, 0x0055, 0x00dc },
+    { 0x00a8, 0x0061, 0x00e4 },
+    { 0x00a8, 0x0065, 0x00eb },
+    { 0x00a8, 0x0069, 0x00ef },
+    { 0x00a8, 0x006f, 0x00f6 },
+    { 0x00a8, 0x0075, 0x00fc },
+    { 0x00a8, 0x0079, 0x00ff },
+    { 0x00b0, 0x0020, 0x00b0 },
+    { 0x00b0, 0x0041, 0x00c5 },
+    { 0x00b0, 0x0061, 0x00e5 },
+    { 0x00b4, 0x0020, 0x00b4 },
+    { 0x00b4, 0x0041, 0x00c1 },
+    { 0x00b4, 0x0045, 0x00c9 },
+    { 0x00b4, 0x0049, 0x00cd },
+    { 0x00b4, 0x004f, 0x00d3 },
+    { 0x00b4, 0x0055, 0x00da },
+    { 0x00b4, 0x0059, 0x00dd },
+    { 0x00b4, 0x0061, 0x00e1 },
+    { 0x00b4, 0x0065, 0x00e9 },
+    { 0x00b4, 0x0069, 0x00ed },
+    { 0x00b4, 0x006f, 0x00f3 },
+    { 0x00b4, 0x0075, 0x00fa },
+    { 0x00b4, 0x0079, 0x00fd },
+    { 0x00b8, 0x0020, 0x00b8 },
+    { 0x00b8, 0x0043, 0x00c7 },
+    { 0x00b8, 0x0063, 0x00e7 },
 };
 
 #endif // QBSDKEYBOARD_DEFAULTMAP_P_H
@@ -0,0 +1,341 @@
+/****************************************************************************
+**
+** Copyright (C) 2015-2016 Oleksandr Tymoshenko <gonzo@bluezbox.com>
+**
+** This file is part of the QtGui module of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:LGPL21$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see http://www.qt.io/terms-conditions. For further
+** information use the contact form at http://www.qt.io/contact-us.
+**
+** GNU Lesser General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU Lesser
+** General Public License version 2.1 or version 3 as published by the Free
+** Software Foundation and appearing in the file LICENSE.LGPLv21 and
+** LICENSE.LGPLv3 included in the packaging of this file. Please review the
+** following information to ensure the GNU Lesser General Public License
+** requirements will be met: https://www.gnu.org/licenses/lgpl.html and
+** http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+**
+** As a special exception, The Qt Company gives you certain additional
+** rights. These rights are described in The Qt Company LGPL Exception
+** version 1.1, included in the file LGPL_EXCEPTION.txt in this package.
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+#include "qbsdkeymap.h"
+#include "qbsdinputlogging_p.h"
+
+#include <QFile>
+
+#include <qdebug.h>
+
+QT_BEGIN_NAMESPACE
+
+#include "qbsdkeyboard_defaultmap.h"
+
+static inline int composeHash(quint32 key, quint32 seed, int shift)
+{
+    return int(((key ^ seed) * 0x9e3779b1u) >> shift);
+}
+
+// Places all keys into a table of 2^bits slots. Without probing the placement
+// only succeeds if the seed spreads the keys without a single collision.
+// Returns the longest probe sequence used, or -1 on failure.
+static int fillComposeTable(const QVector<quint32> &keys, const QVector<quint16> &results,
+                            int bits, quint32 seed, bool allowProbing,
+                            QVector<quint32> *tableKeys, QVector<quint16> *tableResults)
+{
+    const int size = 1 << bits;
+    tableKeys->fill(0, size);
+    tableResults->fill(0xffff, size);
+
+    int maxProbe = 0;
+    for (int i = 0; i < keys.size(); ++i) {
+        int slot = composeHash(keys.at(i), seed, 32 - bits);
+        int probe = 0;
+        while (tableKeys->at(slot) != 0) {
+            if (!allowProbing)
+                return -1;
+            slot = (slot + 1) & (size - 1);
+            ++probe;
+        }
+        (*tableKeys)[slot] = keys.at(i);
+        (*tableResults)[slot] = results.at(i);
+        maxProbe = qMax(maxProbe, probe);
+    }
+    return maxProbe;
+}
+
+// the key a keypad key turns into while NumLock is off
+static int numLockOffKey(int key)
+{
+    switch (key) {
+    case Qt::Key_7: //7 --> Home
+        return Qt::Key_Home;
+    case Qt::Key_8: //8 --> Up
+        return Qt::Key_Up;
+    case Qt::Key_9: //9 --> PgUp
+        return Qt::Key_PageUp;
+    case Qt::Key_4: //4 --> Left
+        return Qt::Key_Left;
+    case Qt::Key_5: //5 --> Clear
+        return Qt::Key_Clear;
+    case Qt::Key_6: //6 --> right
+        return Qt::Key_Right;
+    case Qt::Key_1: //1 --> End
+        return Qt::Key_End;
+    case Qt::Key_2: //2 --> Down
+        return Qt::Key_Down;
+    case Qt::Key_3: //3 --> PgDn
+        return Qt::Key_PageDown;
+    case Qt::Key_0: //0 --> Ins
+        return Qt::Key_Insert;
+    case Qt::Key_Period: //. --> Del
+        return Qt::Key_Delete;
+    default:
+        return key;
+    }
+}
+
+QBsdKeymap::QBsdKeymap() :
+    m_keymap(s_keymapDefault),
+    m_keymapSize(sizeof(s_keymapDefault) / sizeof(s_keymapDefault[0])),
+    m_keycompose(s_keycomposeDefault),
+    m_keycomposeSize(sizeof(s_keycomposeDefault) / sizeof(s_keycomposeDefault[0])),
+    m_composeSeed(0),
+    m_composeShift(0),
+    m_composeMaxProbe(0)
+{
+    buildIndex();
+    buildRecords();
+    buildComposeTable();
+}
+
+QBsdKeymap::QBsdKeymap(const QBsdKeyboardMap::Mapping *keymap, int keymapSize,
+                       const QBsdKeyboardMap::Composing *keycompose, int keycomposeSize) :
+    m_keymap(keymap),
+    m_keymapSize(keymapSize),
+    m_keycompose(keycompose),
+    m_keycomposeSize(keycomposeSize),
+    m_composeSeed(0),
+    m_composeShift(0),
+    m_composeMaxProbe(0)
+{
+    buildIndex();
+    buildRecords();
+    buildComposeTable();
+}
+
+QBsdKeymap::~QBsdKeymap()
+{
+    if (m_keymap != s_keymapDefault)
+        delete [] m_keymap;
+    if (m_keycompose != s_keycomposeDefault)
+        delete [] m_keycompose;
+}
+
+QBsdKeymap *QBsdKeymap::load(const QString &file)
+{
+    qCDebug(qLcBsdKeyboard) << "Load keymap" << file;
+
+    QFile f(file);
+
+    if (!f.open(QIODevice::ReadOnly)) {
+        qWarning("Could not open keymap file '%s'", qPrintable(file));
+        return 0;
+    }
+
+    // .qmap files have a very simple structure:
+    // quint32 magic           (QBsdKeyboardMap::FileMagic)
+    // quint32 version         (QBsdKeyboardMap::FileVersion, 1 is still accepted)
+    // quint32 keymap_size     (# of struct QBsdKeyboardMap::Mappings)
+    // quint32 keycompose_size (# of struct QBsdKeyboardMap::Composings)
+    // all QBsdKeyboardMap::Mappings via QDataStream::operator(<<|>>)
+    // all QBsdKeyboardMap::Composings via QDataStream::operator(<<|>>)
+
+    quint32 qmap_magic, qmap_version, qmap_keymap_size, qmap_keycompose_size;
+
+    QDataStream ds(&f);
+
+    ds >> qmap_magic >> qmap_version >> qmap_keymap_size >> qmap_keycompose_size;
+
+    if (ds.status() != QDataStream::Ok || qmap_magic != QBsdKeyboardMap::FileMagic
+            || qmap_version < 1 || qmap_version > QBsdKeyboardMap::FileVersion
+            || qmap_keymap_size == 0 || qmap_keymap_size >= 0xffff) {
+        qWarning("'%s' is not a valid .qmap keymap file", qPrintable(file));
+        return 0;
+    }
+
+    QBsdKeyboardMap::Mapping *qmap_keymap = new QBsdKeyboardMap::Mapping[qmap_keymap_size];
+    QBsdKeyboardMap::Composing *qmap_keycompose = qmap_keycompose_size ? new QBsdKeyboardMap::Composing[qmap_keycompose_size] : 0;
+
+    for (quint32 i = 0; i < qmap_keymap_size; ++i) {
+        if (qmap_version == 1) {
+            QBsdKeyboardMap::Mapping &m = qmap_keymap[i];
+            quint8 modifiers;
+            ds >> m.keycode >> m.unicode >> m.qtcode >> modifiers >> m.flags >> m.special;
+            m.modifiers = modifiers;
+        } else {
+            ds >> qmap_keymap[i];
+        }
+    }
+    for (quint32 i = 0; i < qmap_keycompose_size; ++i)
+        ds >> qmap_keycompose[i];
+
+    if (ds.status() != QDataStream::Ok) {
+        delete [] qmap_keymap;
+        delete [] qmap_keycompose;
+
+        qWarning("Keymap file '%s' cannot be loaded.", qPrintable(file));
+        return 0;
+    }
+
+    return new QBsdKeymap(qmap_keymap, qmap_keymap_size,
+                          qmap_keycompose ? qmap_keycompose : s_keycomposeDefault,
+                          qmap_keycompose ? int(qmap_keycompose_size) : int(sizeof(s_keycomposeDefault) / sizeof(s_keycomposeDefault[0])));
+}
+
+void QBsdKeymap::buildIndex()
+{
+    m_index.fill(0xffff, QBsdKeyboardMap::KeycodeCount * QBsdKeyboardMap::LookupLevels);
+
+    // the first mapping for a keycode and modifier combination wins
+    for (int i = 0; i < m_keymapSize; ++i) {
+        const QBsdKeyboardMap::Mapping &m = m_keymap[i];
+        if (m.keycode >= QBsdKeyboardMap::KeycodeCount)
+            continue;
+
+        const int level = QBsdKeyboardMap::lookupLevel(QBsdKeyboardMap::foldModifiers(m.modifiers));
+        quint16 &slot = m_index[m.keycode * QBsdKeyboardMap::LookupLevels + level];
+        if (slot == 0xffff)
+            slot = quint16(i);
+    }
+}
+
+void QBsdKeymap::buildRecords()
+{
+    m_records.resize(m_keymapSize);
+
+    for (int i = 0; i < m_keymapSize; ++i) {
+        const QBsdKeyboardMap::Mapping &m = m_keymap[i];
+        KeyRecord &r = m_records[i];
+
+        r.key = m.qtcode & ~QBsdKeyboardMap::QtModifierMask;
+        r.modifiers = Qt::KeyboardModifiers(m.qtcode & QBsdKeyboardMap::QtModifierMask);
+        r.numLockOffKey = (m.qtcode & Qt::KeypadModifier) ? numLockOffKey(r.key) : r.key;
+        r.text = internText(m.unicode);
+    }
+
+    for (int level = 0; level < QBsdKeyboardMap::LookupLevels; ++level) {
+        const quint16 folded = (level & 0x0f) | ((level & 0x10) ? QBsdKeyboardMap::ModMeta : 0);
+        m_qtModifiers[level] = QBsdKeyboardMap::toQtModifiers(folded);
+    }
+}
+
+QString QBsdKeymap::internText(quint16 unicode)
+{
+    if (unicode == 0xffff)
+        return QString();
+
+    QHash<quint16, QString>::const_iterator it = m_texts.constFind(unicode);
+    if (it != m_texts.constEnd())
+        return it.value();
+
+    const QString text(QChar(unicode));
+    m_texts.insert(unicode, text);
+    return text;
+}
+
+void QBsdKeymap::buildComposeTable()
+{
+    // Every sequence is stored under (first << 16 | second) and every distinct
+    // first symbol additionally under (first << 16), so both "does this symbol
+    // start a sequence" and "what does this pair compose to" are one lookup.
+    QVector<quint32> keys;
+    QVector<quint16> results;
+
+    keys.reserve(m_keycomposeSize * 2);
+    results.reserve(m_keycomposeSize * 2);
+
+    for (int i = 0; i < m_keycomposeSize; ++i) {
+        const QBsdKeyboardMap::Composing &c = m_keycompose[i];
+        if (c.first == 0 || c.second == 0)
+            continue;
+
+        const quint32 prefix = quint32(c.first) << 16;
+        if (!keys.contains(prefix)) {
+            keys.append(prefix);
+            results.append(0xffff);
+        }
+
+        const quint32 sequence = prefix | c.second;
+        if (!keys.contains(sequence)) {
+            keys.append(sequence);
+            results.append(c.result);
+            internText(c.result);
+        }
+
+        // an unmatched sequence reports the accent itself
+        internText(c.first);
+    }
+
+    m_composeKeys.clear();
+    m_composeResults.clear();
+    m_composeSeed = 0;
+    m_composeShift = 0;
+    m_composeMaxProbe = 0;
+
+    if (keys.isEmpty())
+        return;
+
+    int bits = 1;
+    while ((1 << bits) < keys.size() * 2)
+        ++bits;
+
+    // Look for a collision-free placement first, so that every lookup is a
+    // single probe, and allow the table to grow up to 8x before giving up
+    // and falling back to linear probing.
+    for (int b = bits; b <= bits + 3; ++b) {
+        for (quint32 seed = 0; seed < 64; ++seed) {
+            if (fillComposeTable(keys, results, b, seed, false, &m_composeKeys, &m_composeResults) == 0) {
+                m_composeSeed = seed;
+                m_composeShift = 32 - b;
+                return;
+            }
+        }
+    }
+
+    m_composeMaxProbe = fillComposeTable(keys, results, bits, 0, true, &m_composeKeys, &m_composeResults);
+    m_composeShift = 32 - bits;
+}
+
+int QBsdKeymap::lookupCompose(quint16 first, quint16 second) const
+{
+    if (m_composeKeys.isEmpty())
+        return -1;
+
+    const quint32 key = (quint32(first) << 16) | second;
+    const int mask = m_composeKeys.size() - 1;
+    int slot = composeHash(key, m_composeSeed, m_composeShift);
+
+    for (int probe = 0; probe <= m_composeMaxProbe; ++probe) {
+        const quint32 k = m_composeKeys.at(slot);
+        if (k == key)
+            return m_composeResults.at(slot);
+        if (k == 0)
+            break;
+        slot = (slot + 1) & mask;
+    }
+
+    return -1;
+}
+
+QT_END_NAMESPACE
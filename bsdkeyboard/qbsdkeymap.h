@@ -0,0 +1,241 @@
+/****************************************************************************
+**
+** Copyright (C) 2015-2016 Oleksandr Tymoshenko <gonzo@bluezbox.com>
+**
+** This file is part of the QtGui module of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:LGPL21$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see http://www.qt.io/terms-conditions. For further
+** information use the contact form at http://www.qt.io/contact-us.
+**
+** GNU Lesser General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU Lesser
+** General Public License version 2.1 or version 3 as published by the Free
+** Software Foundation and appearing in the file LICENSE.LGPLv21 and
+** LICENSE.LGPLv3 included in the packaging of this file. Please review the
+** following information to ensure the GNU Lesser General Public License
+** requirements will be met: https://www.gnu.org/licenses/lgpl.html and
+** http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+**
+** As a special exception, The Qt Company gives you certain additional
+** rights. These rights are described in The Qt Company LGPL Exception
+** version 1.1, included in the file LGPL_EXCEPTION.txt in this package.
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+#ifndef QBSDKEYMAP_H
+#define QBSDKEYMAP_H
+
+#include <QDataStream>
+#include <QHash>
+#include <QString>
+#include <QVector>
+
+QT_BEGIN_NAMESPACE
+
+namespace QBsdKeyboardMap {
+    const quint32 FileMagic = 0x514d4150; // 'QMAP'
+    const quint32 FileVersion = 2;         // version 1 stores 8-bit modifiers
+
+    const int KeycodeCount = 256;
+    const int LookupLevels = 32;           // one per combination of ModLookupMask
+
+    struct Mapping {
+        quint16 keycode;
+        quint16 unicode;
+        quint32 qtcode;
+        quint16 modifiers;
+        quint8 flags;
+        quint16 special;
+
+    };
+
+    struct Composing {
+        quint16 first;
+        quint16 second;
+        quint16 result;
+    };
+
+    enum Flags {
+        NoFlags    = 0x00,
+        IsLetter   = 0x01,
+        IsModifier = 0x02,
+        IsSystem   = 0x08
+    };
+
+    // Mapping::special values of IsSystem keys
+    enum System {
+        SystemConsoleFirst    = 0x0100, // switch to VT 1
+        SystemConsoleMask     = 0x007f,
+        SystemConsoleLast     = 0x017f,
+        SystemConsolePrevious = 0x0180,
+        SystemConsoleNext     = 0x0181
+    };
+
+    enum Modifiers {
+        ModPlain     = 0x0000,
+        ModShift     = 0x0001,
+        ModAltGr     = 0x0002,
+        ModControl   = 0x0004,
+        ModAlt       = 0x0008,
+        ModShiftL    = 0x0010,
+        ModShiftR    = 0x0020,
+        ModCtrlL     = 0x0040,
+        ModCtrlR     = 0x0080,
+        ModCapsShift = 0x0100,
+        ModAltL      = 0x0200,
+        ModAltR      = 0x0400,
+        ModMeta      = 0x0800,
+        ModMetaL     = 0x1000,
+        ModMetaR     = 0x2000,
+
+        // mappings are selected by these; the per-side bits fold into them
+        ModLookupMask = ModShift | ModAltGr | ModControl | ModAlt | ModMeta
+    };
+
+    inline quint16 foldModifiers(quint16 mod)
+    {
+        quint16 folded = mod & ModLookupMask;
+
+        if (mod & (ModShiftL | ModShiftR))
+            folded |= ModShift;
+        if (mod & (ModCtrlL | ModCtrlR))
+            folded |= ModControl;
+        if (mod & (ModAltL | ModAltR))
+            folded |= ModAlt;
+        if (mod & (ModMetaL | ModMetaR))
+            folded |= ModMeta;
+
+        return folded;
+    }
+
+    // index of a folded modifier mask in the per-keycode lookup table
+    inline int lookupLevel(quint16 folded)
+    {
+        return (folded & 0x0f) | ((folded & ModMeta) ? 0x10 : 0);
+    }
+
+    inline Qt::KeyboardModifiers toQtModifiers(quint16 mod)
+    {
+        Qt::KeyboardModifiers qtmod = Qt::NoModifier;
+        const quint16 folded = foldModifiers(mod);
+
+        if (folded & ModShift)
+            qtmod |= Qt::ShiftModifier;
+        if (folded & ModControl)
+            qtmod |= Qt::ControlModifier;
+        if (folded & ModAlt)
+            qtmod |= Qt::AltModifier;
+        if (folded & ModAltGr)
+            qtmod |= Qt::GroupSwitchModifier;
+        if (folded & ModMeta)
+            qtmod |= Qt::MetaModifier;
+
+        return qtmod;
+    }
+
+    // the modifier bits Qt keeps in the upper part of a key code
+    const int QtModifierMask = Qt::ShiftModifier | Qt::ControlModifier | Qt::AltModifier | Qt::MetaModifier
+                               | Qt::KeypadModifier | Qt::GroupSwitchModifier;
+}
+
+inline QDataStream &operator>>(QDataStream &ds, QBsdKeyboardMap::Mapping &m)
+{
+    return ds >> m.keycode >> m.unicode >> m.qtcode >> m.modifiers >> m.flags >> m.special;
+}
+
+inline QDataStream &operator>>(QDataStream &ds, QBsdKeyboardMap::Composing &c)
+{
+    return ds >> c.first >> c.second >> c.result;
+}
+
+// An immutable, fully indexed keymap. Instances are built off the decode path
+// and then published to the keyboard handler as a whole.
+class QBsdKeymap
+{
+public:
+    // Everything the key path needs to report a mapping, prepared up front
+    // so that sending an event neither allocates nor recomputes anything.
+    struct KeyRecord {
+        int key;                          // Qt key code without modifier bits
+        Qt::KeyboardModifiers modifiers;  // modifiers the mapping itself carries
+        int numLockOffKey;                // keypad keys: key reported with NumLock off
+        QString text;                     // shared, empty if the mapping has no text
+    };
+
+    QBsdKeymap();
+    ~QBsdKeymap();
+
+    static QBsdKeymap *load(const QString &file);
+
+    const QBsdKeyboardMap::Mapping *mapping(quint16 keycode, quint16 folded) const
+    {
+        if (keycode >= QBsdKeyboardMap::KeycodeCount)
+            return 0;
+
+        const quint16 i = m_index.at(keycode * QBsdKeyboardMap::LookupLevels + QBsdKeyboardMap::lookupLevel(folded));
+        return (i != 0xffff) ? m_keymap + i : 0;
+    }
+
+    const KeyRecord &record(const QBsdKeyboardMap::Mapping *mapping) const
+    {
+        return m_records.at(int(mapping - m_keymap));
+    }
+
+    Qt::KeyboardModifiers qtModifiers(quint16 folded) const
+    {
+        return m_qtModifiers[QBsdKeyboardMap::lookupLevel(folded)];
+    }
+
+    // shared text for a character produced by the keymap or its compose table
+    QString text(quint16 unicode) const { return m_texts.value(unicode); }
+
+    int lookupCompose(quint16 first, quint16 second) const;
+
+    const QBsdKeyboardMap::Mapping *mappings() const { return m_keymap; }
+    int size() const { return m_keymapSize; }
+
+private:
+    QBsdKeymap(const QBsdKeyboardMap::Mapping *keymap, int keymapSize,
+               const QBsdKeyboardMap::Composing *keycompose, int keycomposeSize);
+    Q_DISABLE_COPY(QBsdKeymap)
+
+    void buildIndex();
+    void buildRecords();
+    void buildComposeTable();
+    QString internText(quint16 unicode);
+
+    const QBsdKeyboardMap::Mapping *m_keymap;
+    int m_keymapSize;
+    const QBsdKeyboardMap::Composing *m_keycompose;
+    int m_keycomposeSize;
+
+    // KeycodeCount x LookupLevels offsets into m_keymap, 0xffff if unmapped
+    QVector<quint16> m_index;
+
+    // one per mapping, in keymap order
+    QVector<KeyRecord> m_records;
+    QHash<quint16, QString> m_texts;
+    Qt::KeyboardModifiers m_qtModifiers[QBsdKeyboardMap::LookupLevels];
+
+    // open-addressed hash over (first << 16 | second)
+    QVector<quint32> m_composeKeys;
+    QVector<quint16> m_composeResults;
+    quint32 m_composeSeed;
+    int m_composeShift;
+    int m_composeMaxProbe;
+
+    static const QBsdKeyboardMap::Mapping s_keymapDefault[];
+    static const QBsdKeyboardMap::Composing s_keycomposeDefault[];
+};
+
+QT_END_NAMESPACE
+
+#endif // QBSDKEYMAP_H
@@ -7,9 +7,19 @@ load(qt_plugin)
 
 QT += core-private gui-private
 
-HEADERS = qbsdmouse.h
+HEADERS = qbsdmouse.h \
+         qbsdbuttonemulator.h \
+         qbsdmotionpredictor.h \
+         qbsdmousedecoder.h \
+         qbsdtouchpad.h
 SOURCES = main.cpp \
-         qbsdmouse.cpp
+         qbsdmouse.cpp \
+         qbsdbuttonemulator.cpp \
+         qbsdmotionpredictor.cpp \
+         qbsdmousedecoder.cpp \
+         qbsdtouchpad.cpp
+
+include(../shared/shared.pri)
 
 OTHER_FILES += \
     qbsdmouse.json
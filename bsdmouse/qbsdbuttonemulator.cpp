@@ -0,0 +1,119 @@
+/****************************************************************************
+**
+** Copyright (C) 2015-2016 Oleksandr Tymoshenko <gonzo@bluezbox.com>
+**
+** This file is part of the QtGui module of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:LGPL21$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see http://www.qt.io/terms-conditions. For further
+** information use the contact form at http://www.qt.io/contact-us.
+**
+** GNU Lesser General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU Lesser
+** General Public License version 2.1 or version 3 as published by the Free
+** Software Foundation and appearing in the file LICENSE.LGPLv21 and
+** LICENSE.LGPLv3 included in the packaging of this file. Please review the
+** following information to ensure the GNU Lesser General Public License
+** requirements will be met: https://www.gnu.org/licenses/lgpl.html and
+** http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+**
+** As a special exception, The Qt Company gives you certain additional
+** rights. These rights are described in The Qt Company LGPL Exception
+** version 1.1, included in the file LGPL_EXCEPTION.txt in this package.
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+#include "qbsdbuttonemulator.h"
+
+#include <QtGlobal>
+
+QT_BEGIN_NAMESPACE
+
+static const Qt::MouseButtons Chord = Qt::LeftButton | Qt::RightButton;
+
+QBsdButtonEmulator::QBsdButtonEmulator(int timeoutMs) :
+    m_timeout(qBound(1, timeoutMs, int(MaxTimeout))),
+    m_state(Idle),
+    m_raw(Qt::NoButton)
+{
+}
+
+void QBsdButtonEmulator::reset()
+{
+    m_state = Idle;
+    m_raw = Qt::NoButton;
+}
+
+Qt::MouseButtons QBsdButtonEmulator::output() const
+{
+    const Qt::MouseButtons other = m_raw & ~Chord;
+    switch (m_state) {
+    case PendingLeft:
+    case PendingRight:
+        return other;
+    case Middle:
+        return other | Qt::MiddleButton;
+    case Idle:
+    case PassThrough:
+        break;
+    }
+    return m_raw;
+}
+
+int QBsdButtonEmulator::update(Qt::MouseButtons raw, Qt::MouseButtons *states)
+{
+    const Qt::MouseButtons chord = raw & Chord;
+    int count = 0;
+
+    m_raw = raw;
+
+    if (isPending()) {
+        const Qt::MouseButton held = m_state == PendingLeft ? Qt::LeftButton : Qt::RightButton;
+        if (chord == Chord) {
+            m_state = Middle;
+        } else if (!(chord & held)) {
+            // released before the other button came: a plain click
+            states[count++] = (raw & ~Chord) | held;
+            m_state = Idle;
+        }
+    }
+
+    switch (m_state) {
+    case Idle:
+        if (chord == Chord)
+            m_state = Middle;
+        else if (chord == Qt::LeftButton)
+            m_state = PendingLeft;
+        else if (chord == Qt::RightButton)
+            m_state = PendingRight;
+        break;
+    case Middle:
+    case PassThrough:
+        if (!chord)
+            m_state = Idle;
+        break;
+    case PendingLeft:
+    case PendingRight:
+        break;
+    }
+
+    states[count++] = output();
+    return count;
+}
+
+Qt::MouseButtons QBsdButtonEmulator::expire()
+{
+    // too late for a chord, the held button goes out as it is
+    if (isPending())
+        m_state = PassThrough;
+    return output();
+}
+
+QT_END_NAMESPACE
@@ -0,0 +1,80 @@
+/****************************************************************************
+**
+** Copyright (C) 2015-2016 Oleksandr Tymoshenko <gonzo@bluezbox.com>
+**
+** This file is part of the QtGui module of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:LGPL21$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see http://www.qt.io/terms-conditions. For further
+** information use the contact form at http://www.qt.io/contact-us.
+**
+** GNU Lesser General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU Lesser
+** General Public License version 2.1 or version 3 as published by the Free
+** Software Foundation and appearing in the file LICENSE.LGPLv21 and
+** LICENSE.LGPLv3 included in the packaging of this file. Please review the
+** following information to ensure the GNU Lesser General Public License
+** requirements will be met: https://www.gnu.org/licenses/lgpl.html and
+** http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+**
+** As a special exception, The Qt Company gives you certain additional
+** rights. These rights are described in The Qt Company LGPL Exception
+** version 1.1, included in the file LGPL_EXCEPTION.txt in this package.
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+#ifndef QBSDBUTTONEMULATOR_H
+#define QBSDBUTTONEMULATOR_H
+
+#include <QtCore/qnamespace.h>
+
+QT_BEGIN_NAMESPACE
+
+// Middle button emulation for two-button devices: pressing left and right
+// together reports the middle button until both are released again. A
+// lone left or right press is held back until the other button follows,
+// the button is released (a plain click) or the timeout expires, so no
+// press is delayed by more than the timeout. Other buttons pass through.
+class QBsdButtonEmulator
+{
+public:
+    enum { DefaultTimeout = 50, MaxTimeout = 200 };    // ms
+
+    explicit QBsdButtonEmulator(int timeoutMs = DefaultTimeout);
+
+    int timeout() const { return m_timeout; }
+
+    // Feeds the device's buttons, fills states with up to two button
+    // states to report in order and returns how many there are. While
+    // isPending(), expire() must be called once the timeout has passed.
+    int update(Qt::MouseButtons raw, Qt::MouseButtons *states);
+    Qt::MouseButtons expire();
+    bool isPending() const { return m_state == PendingLeft || m_state == PendingRight; }
+    void reset();
+
+private:
+    enum State {
+        Idle,
+        PendingLeft,
+        PendingRight,
+        Middle,
+        PassThrough
+    };
+
+    Qt::MouseButtons output() const;
+
+    int m_timeout;
+    State m_state;
+    Qt::MouseButtons m_raw;
+};
+
+QT_END_NAMESPACE
+
+#endif // QBSDBUTTONEMULATOR_H
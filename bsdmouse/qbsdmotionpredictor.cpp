@@ -0,0 +1,87 @@
+/****************************************************************************
+**
+** Copyright (C) 2015-2016 Oleksandr Tymoshenko <gonzo@bluezbox.com>
+**
+** This file is part of the QtGui module of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:LGPL21$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see http://www.qt.io/terms-conditions. For further
+** information use the contact form at http://www.qt.io/contact-us.
+**
+** GNU Lesser General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU Lesser
+** General Public License version 2.1 or version 3 as published by the Free
+** Software Foundation and appearing in the file LICENSE.LGPLv21 and
+** LICENSE.LGPLv3 included in the packaging of this file. Please review the
+** following information to ensure the GNU Lesser General Public License
+** requirements will be met: https://www.gnu.org/licenses/lgpl.html and
+** http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+**
+** As a special exception, The Qt Company gives you certain additional
+** rights. These rights are described in The Qt Company LGPL Exception
+** version 1.1, included in the file LGPL_EXCEPTION.txt in this package.
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+#include "qbsdmotionpredictor.h"
+
+QT_BEGIN_NAMESPACE
+
+enum {
+    SampleGap = 50          // ms without data after which motion starts over
+};
+
+static const qreal Smoothing = 0.5;
+
+QBsdMotionPredictor::QBsdMotionPredictor(int horizonMs, int maxOvershoot) :
+    m_horizon(horizonMs),
+    m_maxOvershoot(maxOvershoot),
+    m_hasSample(false),
+    m_lastTime(0),
+    m_vx(0),
+    m_vy(0)
+{
+}
+
+void QBsdMotionPredictor::reset()
+{
+    m_hasSample = false;
+    m_vx = m_vy = 0;
+}
+
+void QBsdMotionPredictor::addSample(const QPoint &pos, qint64 nsecs)
+{
+    if (m_hasSample) {
+        const qreal dt = qreal(nsecs - m_lastTime) / 1000000;
+        // several packets read in one go share a timestamp; measuring
+        // from the earlier sample adds their motion up
+        if (dt <= 0)
+            return;
+        if (dt > SampleGap) {
+            m_vx = m_vy = 0;
+        } else {
+            const qreal dtClamped = qMax(dt, qreal(1));
+            m_vx += Smoothing * ((pos.x() - m_lastPos.x()) / dtClamped - m_vx);
+            m_vy += Smoothing * ((pos.y() - m_lastPos.y()) / dtClamped - m_vy);
+        }
+    }
+
+    m_hasSample = true;
+    m_lastPos = pos;
+    m_lastTime = nsecs;
+}
+
+QPoint QBsdMotionPredictor::predict(const QPoint &pos) const
+{
+    const int dx = qBound(-m_maxOvershoot, qRound(m_vx * m_horizon), m_maxOvershoot);
+    const int dy = qBound(-m_maxOvershoot, qRound(m_vy * m_horizon), m_maxOvershoot);
+    return pos + QPoint(dx, dy);
+}
+
+QT_END_NAMESPACE
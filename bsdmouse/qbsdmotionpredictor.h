@@ -0,0 +1,68 @@
+/****************************************************************************
+**
+** Copyright (C) 2015-2016 Oleksandr Tymoshenko <gonzo@bluezbox.com>
+**
+** This file is part of the QtGui module of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:LGPL21$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see http://www.qt.io/terms-conditions. For further
+** information use the contact form at http://www.qt.io/contact-us.
+**
+** GNU Lesser General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU Lesser
+** General Public License version 2.1 or version 3 as published by the Free
+** Software Foundation and appearing in the file LICENSE.LGPLv21 and
+** LICENSE.LGPLv3 included in the packaging of this file. Please review the
+** following information to ensure the GNU Lesser General Public License
+** requirements will be met: https://www.gnu.org/licenses/lgpl.html and
+** http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+**
+** As a special exception, The Qt Company gives you certain additional
+** rights. These rights are described in The Qt Company LGPL Exception
+** version 1.1, included in the file LGPL_EXCEPTION.txt in this package.
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+#ifndef QBSDMOTIONPREDICTOR_H
+#define QBSDMOTIONPREDICTOR_H
+
+#include <QPoint>
+
+QT_BEGIN_NAMESPACE
+
+// Extrapolates the pointer position a fixed horizon ahead from a smoothed
+// velocity, to hide the latency between reading a packet and the frame
+// that shows it. The offset never exceeds maxOvershoot pixels per axis.
+class QBsdMotionPredictor
+{
+public:
+    explicit QBsdMotionPredictor(int horizonMs, int maxOvershoot = 24);
+
+    int horizon() const { return m_horizon; }
+
+    void addSample(const QPoint &pos, qint64 nsecs);
+    QPoint predict(const QPoint &pos) const;
+    void reset();
+
+    // whether pos is where the last sample was taken
+    bool isAt(const QPoint &pos) const { return m_hasSample && pos == m_lastPos; }
+
+private:
+    int m_horizon;
+    int m_maxOvershoot;
+
+    bool m_hasSample;
+    QPoint m_lastPos;
+    qint64 m_lastTime;
+    qreal m_vx, m_vy;      // pixels per millisecond
+};
+
+QT_END_NAMESPACE
+
+#endif // QBSDMOTIONPREDICTOR_H
@@ -31,11 +31,24 @@
 ****************************************************************************/
 
 #include "qbsdmouse.h"
+#include "qbsdtouchpad.h"
+#include "qbsdbuttonemulator.h"
+#include "qbsdmotionpredictor.h"
+#include "qbsddevicemonitor_p.h"
+#include "qbsdeventqueue_p.h"
+#include "qbsdinjectionserver_p.h"
+#include "qbsdinputlogging_p.h"
+#include "qbsdinputtrace_p.h"
+#include "qbsdseat_p.h"
 
 #include <QSocketNotifier>
 #include <QStringList>
+#include <QThread>
+#include <QTimer>
+#include <QScreen>
 #include <QPoint>
 #include <QGuiApplication>
+#include <QTouchDevice>
 #include <qpa/qwindowsysteminterface.h>
 
 #include <private/qcore_unix_p.h>
@@ -44,6 +57,7 @@
 #include <errno.h>
 #include <fcntl.h>
 #include <sys/mouse.h>
+#include <termios.h>
 #include <unistd.h>
 
 QT_BEGIN_NAMESPACE
@@ -54,76 +68,380 @@ enum {
     PsmLevelNative = 2
 };
 
+enum {
+    OpenRetries = 10,       // after a hotplugged node failed to open
+    OpenRetryInterval = 500 // ms
+};
+
 QBsdMouseHandler::QBsdMouseHandler(const QString &key, const QString &specification) :
     m_notifier(0),
+    m_devFd(-1),
     m_packetSize(0),
     m_x(0),
     m_y(0),
     m_xOffset(0),
     m_yOffset(0),
-    m_buttons(Qt::NoButton)
+    m_buttons(Qt::NoButton),
+    m_sentButtons(Qt::NoButton),
+    m_rawButtons(Qt::NoButton),
+    m_inputState(QBsdInputState::instance()),
+    m_touchDevice(0),
+    m_native(false),
+    m_protocol(QBsdMouseDecoder::NoProtocol),
+    m_baud(1200),
+    m_monitor(0),
+    m_openRetryTimer(0),
+    m_openRetries(0),
+    m_thread(0),
+    m_correctionTimer(0),
+    m_eventQueue(new QBsdEventQueue(this)),
+    m_injectionServer(0),
+    m_directCursor(false),
+    m_seat(0),
+    m_emulationTimer(0),
+    m_stats(0)
 {
     QByteArray device;
-    int level;
+    bool threaded = false;
+    bool hotplug = false;
+    int predictMs = -1;
+    QString injectPath;
+    QString seatName;
+    QString screenName;
+    int emulationMs = -1;
     Q_UNUSED(key);
 
     setObjectName(QLatin1String("BSD Sysmouse Handler"));
 
-    if (specification.startsWith("/dev/"))
-        device = QFile::encodeName(specification);
+    const QStringList args = specification.split(QLatin1Char(':'));
+    for (const QString &arg : args) {
+        if (arg.startsWith(QLatin1String("/dev/")))
+            device = QFile::encodeName(arg);
+        else if (arg == QLatin1String("native"))
+            m_native = true;
+        else if (arg.startsWith(QLatin1String("protocol="))) {
+            m_protocol = QBsdMouseDecoder::protocolFromName(arg.mid(9));
+            if (m_protocol == QBsdMouseDecoder::NoProtocol)
+                qWarning("Unknown mouse protocol %s, using the default", qPrintable(arg.mid(9)));
+        }
+        else if (arg.startsWith(QLatin1String("baud=")))
+            m_baud = arg.mid(5).toInt();
+        else if (arg == QLatin1String("thread"))
+            threaded = true;
+        else if (arg == QLatin1String("hotplug"))
+            hotplug = true;
+        else if (arg == QLatin1String("predict"))
+            predictMs = 0;
+        else if (arg.startsWith(QLatin1String("predict=")))
+            predictMs = arg.mid(8).toInt();
+        else if (arg.startsWith(QLatin1String("inject=")))
+            injectPath = arg.mid(7);
+        else if (arg == QLatin1String("cursor"))
+            m_directCursor = true;
+        else if (arg.startsWith(QLatin1String("seat=")))
+            seatName = arg.mid(5);
+        else if (arg.startsWith(QLatin1String("screen=")))
+            screenName = arg.mid(7);
+        else if (arg == QLatin1String("emulate3"))
+            emulationMs = QBsdButtonEmulator::DefaultTimeout;
+        else if (arg.startsWith(QLatin1String("emulate3=")))
+            emulationMs = arg.mid(9).toInt();
+    }
+
+    m_clock.start();
+
+    if (!seatName.isEmpty() || !screenName.isEmpty()) {
+        if (seatName.isEmpty())
+            seatName = QLatin1String("screen-") + screenName;
+        m_seat = m_inputState->seat(seatName);
+        if (!m_seat->bindScreen(screenName))
+            qWarning("Seat %s is already bound to another screen", qPrintable(seatName));
+        m_eventQueue->setSeat(m_seat);
+
+        // start in the middle of the seat's screen
+        const QPoint center = m_seat->geometry().center();
+        m_x = center.x();
+        m_y = center.y();
+    }
+
+    if (predictMs >= 0) {
+        // by default look one frame of the primary screen ahead
+        if (predictMs == 0) {
+            const qreal rate = QGuiApplication::primaryScreen()->refreshRate();
+            predictMs = qRound(1000 / (rate > 0 ? rate : 60));
+        }
+        m_predictor.reset(new QBsdMotionPredictor(predictMs));
+
+        // puts the pointer back where it really is once motion stops
+        m_correctionTimer = new QTimer(this);
+        m_correctionTimer->setSingleShot(true);
+        connect(m_correctionTimer, SIGNAL(timeout()), this, SLOT(sendMouseEvent()));
+    }
+
+    if (emulationMs >= 0) {
+        m_buttonEmulator.reset(new QBsdButtonEmulator(emulationMs));
+        m_emulationTimer = new QTimer(this);
+        m_emulationTimer->setSingleShot(true);
+        m_emulationTimer->setTimerType(Qt::PreciseTimer);
+        m_emulationTimer->setInterval(m_buttonEmulator->timeout());
+        connect(m_emulationTimer, SIGNAL(timeout()), this, SLOT(expireButtonEmulation()));
+    }
 
     if (device.isEmpty())
         device = QByteArrayLiteral("/dev/sysmouse");
+    m_device = device;
+
+    m_stats = m_inputState->registerStats("mouse", device);
+    m_eventQueue->setStats(m_stats);
+
+    if (!injectPath.isEmpty()) {
+        // synthetic packets in the device's protocol for load testing
+        m_injectionServer = new QBsdInjectionServer(injectPath, this);
+        connect(m_injectionServer, SIGNAL(received(int,QByteArray)), this, SLOT(injectInput(int,QByteArray)));
+        connect(m_injectionServer, SIGNAL(clientClosed(int)), this, SLOT(injectionClientClosed(int)));
+    }
+
+    if (hotplug) {
+        m_monitor = new QBsdDeviceMonitor(QFile::decodeName(device), this);
+        connect(m_monitor, SIGNAL(deviceAdded()), this, SLOT(openDevice()));
+        connect(m_monitor, SIGNAL(deviceRemoved()), this, SLOT(closeDevice()));
+        m_openRetryTimer = new QTimer(this);
+        m_openRetryTimer->setSingleShot(true);
+        m_openRetryTimer->setInterval(OpenRetryInterval);
+        connect(m_openRetryTimer, SIGNAL(timeout()), this, SLOT(openDevice()));
+    } else {
+        openDevice();
+    }
+
+    if (threaded) {
+        // not our child: we are about to live in it
+        m_thread = new QThread;
+        m_thread->setObjectName(QLatin1String("BsdMouse"));
+        m_thread->start();
+        moveToThread(m_thread);
+    }
+
+    // probing may be slow, do it from the event loop of whichever thread
+    // reads the device rather than holding up application startup
+    if (m_monitor)
+        QMetaObject::invokeMethod(this, "openDevice", Qt::QueuedConnection);
+}
+
+void QBsdMouseHandler::openDevice()
+{
+    if (m_devFd >= 0)
+        return;
+
+    const QByteArray &device = m_device;
+    bool native = m_native;
 
     m_devFd = QT_OPEN(device.constData(), O_RDONLY);
     if (m_devFd < 0) {
-        qErrnoWarning(errno, "open(%s) failed", device.constData());
+        // with hotplug, the monitor calls us again once the node shows
+        // up; one that just did may still be busy, or wait for devfs
+        // rules to make it accessible
+        if (m_monitor && errno != ENOENT && m_openRetries < OpenRetries) {
+            ++m_openRetries;
+            m_openRetryTimer->start();
+            return;
+        }
+        if (!m_monitor || errno != ENOENT)
+            qErrnoWarning(errno, "open(%s) failed", device.constData());
+        m_openRetries = 0;
         return;
     }
+    m_openRetries = 0;
 
-    if (ioctl(m_devFd, MOUSE_GETLEVEL, &level)) {
-        qErrnoWarning(errno, "ioctl(%s, MOUSE_GETLEVEL) failed", device.constData());
+    if (isatty(m_devFd)) {
+        // serial mouse, speaks its protocol without any driver help
+        QBsdMouseDecoder::Protocol protocol = m_protocol;
+        if (protocol == QBsdMouseDecoder::NoProtocol)
+            protocol = QBsdMouseDecoder::MouseSystems;
+        if (!setupSerial(device, m_baud)) {
+            close(m_devFd);
+            m_devFd = -1;
+            return;
+        }
+        m_decoder.setProtocol(protocol);
+        m_packetSize = m_decoder.packetSize();
+    } else {
+        // read PS/2 packets from psm(4) directly instead of through moused
+        if (device.startsWith("/dev/psm"))
+            native = true;
+        if (!setupLevel(device, native)) {
+            close(m_devFd);
+            m_devFd = -1;
+            return;
+        }
+    }
+
+    if (fcntl(m_devFd, F_SETFL, O_NONBLOCK)) {
+        qErrnoWarning(errno, "fcntl(%s, F_SETFL, O_NONBLOCK) failed", device.constData());
         close(m_devFd);
         m_devFd = -1;
         return;
     }
 
+    qCDebug(qLcBsdMouse, "Opened %s: protocol %d, packet size %d%s", device.constData(),
+            int(m_decoder.protocol()), m_packetSize, m_touchpad ? ", touchpad" : "");
+
+    m_notifier.reset(new QSocketNotifier(m_devFd, QSocketNotifier::Read, this));
+    connect(m_notifier.data(), SIGNAL(activated(int)), this, SLOT(readMouseData()));
+}
+
+void QBsdMouseHandler::closeDevice()
+{
+    if (m_devFd < 0)
+        return;
+
+    // may be called from the notifier's own activation
+    if (m_notifier) {
+        m_notifier->setEnabled(false);
+        m_notifier.take()->deleteLater();
+    }
+
+    close(m_devFd);
+    m_devFd = -1;
+    m_packetSize = 0;
+    m_decoder.setProtocol(QBsdMouseDecoder::NoProtocol);
+    m_touchpad.reset();
+
+    // the next device may speak another format; clients start over too
+    qDeleteAll(m_injectClients);
+    m_injectClients.clear();
+
+    // buttons held on the lost device are released
+    m_rawButtons = Qt::NoButton;
+    if (m_buttonEmulator) {
+        m_emulationTimer->stop();
+        m_buttonEmulator->reset();
+    }
+    if (m_buttons != Qt::NoButton) {
+        m_buttons = Qt::NoButton;
+        sendMouseEvent();
+    }
+}
+
+void QBsdMouseHandler::detachFromThread()
+{
+    m_notifier.reset();
+    moveToThread(m_thread->thread());
+}
+
+bool QBsdMouseHandler::setupLevel(const QByteArray &device, bool native)
+{
+    int level;
+
+    // psm(4) resets the level on open, so native mode has to be requested
+    level = PsmLevelNative;
+    if (native && ioctl(m_devFd, MOUSE_SETLEVEL, &level))
+        qErrnoWarning(errno, "ioctl(%s, MOUSE_SETLEVEL) failed", device.constData());
+
+    if (ioctl(m_devFd, MOUSE_GETLEVEL, &level)) {
+        qErrnoWarning(errno, "ioctl(%s, MOUSE_GETLEVEL) failed", device.constData());
+        return false;
+    }
+
     switch (level) {
     case PsmLevelBasic:
-        m_packetSize = 5;
+        m_decoder.setProtocol(QBsdMouseDecoder::MouseSystems);
+        m_packetSize = m_decoder.packetSize();
         break;
     case PsmLevelExtended:
-        m_packetSize = 8;
+        m_decoder.setProtocol(QBsdMouseDecoder::SysMouse);
+        m_packetSize = m_decoder.packetSize();
+        break;
+    case PsmLevelNative: {
+        mousehw_t hw;
+        mousemode_t mode;
+        if (ioctl(m_devFd, MOUSE_GETHWINFO, &hw) || ioctl(m_devFd, MOUSE_GETMODE, &mode)) {
+            qErrnoWarning(errno, "ioctl(%s, MOUSE_GETMODE) failed", device.constData());
+            return false;
+        }
+
+        if (hw.model == MOUSE_MODEL_SYNAPTICS && mode.packetsize == QBsdTouchpad::PacketSize) {
+            m_touchpad.reset(new QBsdTouchpad);
+        } else if (mode.packetsize == 3) {
+            m_decoder.setProtocol(QBsdMouseDecoder::Ps2);
+        } else if (mode.packetsize == 4) {
+            m_decoder.setProtocol(QBsdMouseDecoder::IntelliMouse);
+        } else {
+            qWarning("Unsupported native protocol on %s", device.constData());
+            return false;
+        }
+        m_packetSize = mode.packetsize;
         break;
+    }
     default:
         qWarning("Unsupported mouse device operation level: %d", level);
-        close(m_devFd);
-        m_devFd = -1;
-        return;
+        return false;
     }
 
-    if (fcntl(m_devFd, F_SETFL, O_NONBLOCK)) {
-        qErrnoWarning(errno, "fcntl(%s, F_SETFL, O_NONBLOCK) failed", device.constData());
-        close(m_devFd);
-        m_devFd = -1;
-        return;
+    return true;
+}
+
+bool QBsdMouseHandler::setupSerial(const QByteArray &device, int baud)
+{
+    struct termios tio;
+    speed_t speed;
+
+    switch (baud) {
+    case 1200: speed = B1200; break;
+    case 2400: speed = B2400; break;
+    case 4800: speed = B4800; break;
+    case 9600: speed = B9600; break;
+    default:
+        qWarning("Unsupported serial mouse speed: %d", baud);
+        return false;
     }
 
-    m_notifier.reset(new QSocketNotifier(m_devFd, QSocketNotifier::Read, this));
-    connect(m_notifier.data(), SIGNAL(activated(int)), this, SLOT(readMouseData()));
+    if (tcgetattr(m_devFd, &tio)) {
+        qErrnoWarning(errno, "tcgetattr(%s) failed", device.constData());
+        return false;
+    }
+
+    // raw 8N2, as MouseSystems mice send two stop bits
+    cfmakeraw(&tio);
+    tio.c_cflag |= CLOCAL | CREAD | CSTOPB;
+    tio.c_cc[VMIN] = 1;
+    tio.c_cc[VTIME] = 0;
+    cfsetispeed(&tio, speed);
+    cfsetospeed(&tio, speed);
+
+    if (tcsetattr(m_devFd, TCSANOW, &tio)) {
+        qErrnoWarning(errno, "tcsetattr(%s) failed", device.constData());
+        return false;
+    }
+
+    return true;
 }
 
 QBsdMouseHandler::~QBsdMouseHandler()
 {
+    if (m_thread) {
+        // the notifiers have to go away in the thread they live in
+        if (thread() == m_thread && QThread::currentThread() != m_thread)
+            QMetaObject::invokeMethod(this, "detachFromThread", Qt::BlockingQueuedConnection);
+        m_thread->quit();
+        m_thread->wait();
+        delete m_thread;
+    }
+
     if (m_devFd != -1)
         close(m_devFd);
+
+    qDeleteAll(m_injectClients);
+
+#if QT_VERSION >= QT_VERSION_CHECK(5, 10, 0) && !defined(QT_NO_GESTURES)
+    if (m_touchDevice) {
+        QWindowSystemInterface::unregisterTouchDevice(m_touchDevice);
+        delete m_touchDevice;
+    }
+#endif
 }
 
 void QBsdMouseHandler::readMouseData()
 {
-    int8_t packet[MOUSE_SYS_PACKETSIZE];
-    uint8_t status;
-    int16_t relx, rely;
     int bytes;
 
     if (m_devFd < 0)
@@ -132,19 +450,194 @@ void QBsdMouseHandler::readMouseData()
     if (m_packetSize == 0)
         return;
 
-    // packet format described in mouse(4)
-    while ((bytes = read(m_devFd, packet, m_packetSize)) == m_packetSize) {
-        relx = packet[1] + packet[3];
-        rely = -(packet[2] + packet[4]);
+    // reads need not end on a packet boundary, the decoder or the
+    // touchpad frames the stream
+    quint8 buffer[64];
+    const quint64 errors = m_stats->value(QBsdInputStats::FramingErrors);
+    while ((bytes = read(m_devFd, buffer, sizeof(buffer))) > 0) {
+        QBSD_TRACE_READ(m_devFd, bytes);
+        m_stats->add(QBsdInputStats::Reads);
+        m_stats->add(QBsdInputStats::Bytes, quint64(bytes));
+        processInput(&m_decoder, m_touchpad.data(), buffer, bytes);
+    }
+    // the one that found nothing more to read
+    m_stats->add(QBsdInputStats::Reads);
+
+    if (m_stats->value(QBsdInputStats::FramingErrors) != errors)
+        qCDebug(qLcBsdMouse, "Lost packet alignment, %llu framing errors so far",
+                m_stats->value(QBsdInputStats::FramingErrors));
+
+    // unplugged; the monitor reopens it when it comes back
+    if (m_monitor && (bytes == 0 || (errno != EAGAIN && errno != EINTR))) {
+        closeDevice();
+        return;
+    }
+
+    sendMotionEvent();
+}
+
+void QBsdMouseHandler::processInput(QBsdMouseDecoder *decoder, QBsdTouchpad *touchpad, const quint8 *data, int size)
+{
+    if (touchpad) {
+        const quint64 errors = touchpad->framingErrors();
+        QBsdTouchpad::Report report;
+        const qint64 timestamp = m_clock.elapsed();
+        for (int i = 0; i < size; ++i) {
+            if (touchpad->push(data[i], timestamp, &report))
+                processTouchpadReport(report);
+        }
+        if (touchpad->framingErrors() != errors)
+            m_stats->add(QBsdInputStats::FramingErrors, touchpad->framingErrors() - errors);
+    } else {
+        const quint64 errors = decoder->framingErrors();
+        QBsdMouseDecoder::Packet decoded;
+        for (int i = 0; i < size; ++i) {
+            if (decoder->push(data[i], &decoded))
+                processPacket(decoded);
+        }
+        if (decoder->framingErrors() != errors)
+            m_stats->add(QBsdInputStats::FramingErrors, decoder->framingErrors() - errors);
+    }
+}
+
+void QBsdMouseHandler::injectInput(int client, const QByteArray &data)
+{
+    m_stats->add(QBsdInputStats::InjectedBatches);
+    m_stats->add(QBsdInputStats::InjectedBytes, quint64(data.size()));
+
+    // injected bytes use the device's format but each client keeps its
+    // own framing, so a partial packet cannot misalign the device stream
+    // or another client's; without an open device they are taken as
+    // sysmouse level 1
+    InjectClient *&injectClient = m_injectClients[client];
+    if (!injectClient)
+        injectClient = new InjectClient;
+    if (m_touchpad) {
+        if (!injectClient->touchpad)
+            injectClient->touchpad.reset(new QBsdTouchpad);
+    } else {
+        injectClient->touchpad.reset();
+        QBsdMouseDecoder::Protocol protocol = m_decoder.protocol();
+        if (protocol == QBsdMouseDecoder::NoProtocol)
+            protocol = m_protocol != QBsdMouseDecoder::NoProtocol ? m_protocol : QBsdMouseDecoder::SysMouse;
+        if (injectClient->decoder.protocol() != protocol)
+            injectClient->decoder.setProtocol(protocol);
+    }
+
+    processInput(&injectClient->decoder, injectClient->touchpad.data(),
+                 reinterpret_cast<const quint8 *>(data.constData()), data.size());
+    sendMotionEvent();
+}
+
+void QBsdMouseHandler::injectionClientClosed(int client)
+{
+    delete m_injectClients.take(client);
+}
+
+void QBsdMouseHandler::processPacket(const QBsdMouseDecoder::Packet &packet)
+{
+    QBSD_TRACE_MOUSE_PACKET(packet.dx, packet.dy, int(packet.buttons));
+    m_stats->add(QBsdInputStats::Packets);
+    m_inputState->recorder.record(QBsdFlightRecorder::MousePacket, packet.dx, packet.dy, int(packet.buttons));
+
+    m_x += packet.dx;
+    m_y += packet.dy;
+
+    updateButtons(packet.buttons);
+
+    if (packet.dz)
+        sendWheelEvent(QPoint(0, packet.dz * 120));
+}
+
+void QBsdMouseHandler::updateButtons(Qt::MouseButtons buttons)
+{
+    if (buttons == m_rawButtons)
+        return;
+    m_rawButtons = buttons;
+
+    if (!m_buttonEmulator) {
+        m_buttons = buttons;
+        sendMouseEvent();
+        return;
+    }
 
-        m_x += relx;
-        m_y += rely;
+    Qt::MouseButtons states[2];
+    const int count = m_buttonEmulator->update(buttons, states);
+    for (int i = 0; i < count; ++i) {
+        if (states[i] != m_buttons) {
+            m_buttons = states[i];
+            sendMouseEvent();
+        }
+    }
 
-        status = packet[0] & MOUSE_SYS_STDBUTTONS;
+    // a lone left or right press waits at most this long for its partner
+    if (m_buttonEmulator->isPending()) {
+        if (!m_emulationTimer->isActive())
+            m_emulationTimer->start();
+    } else {
+        m_emulationTimer->stop();
     }
+}
 
+void QBsdMouseHandler::expireButtonEmulation()
+{
+    const Qt::MouseButtons buttons = m_buttonEmulator->expire();
+    if (buttons != m_buttons) {
+        m_buttons = buttons;
+        sendMouseEvent();
+    }
+}
+
+void QBsdMouseHandler::processTouchpadReport(const QBsdTouchpad::Report &report)
+{
+    QBSD_TRACE_MOUSE_PACKET(report.dx, report.dy, int(report.buttons));
+    m_stats->add(QBsdInputStats::Packets);
+    m_inputState->recorder.record(QBsdFlightRecorder::MousePacket, report.dx, report.dy, int(report.buttons));
+
+    m_x += report.dx;
+    m_y += report.dy;
+
+    updateButtons(report.buttons);
+
+    if (report.tap != Qt::NoButton) {
+        m_buttons |= report.tap;
+        sendMouseEvent();
+        m_buttons &= ~report.tap;
+        sendMouseEvent();
+    }
+
+    if (report.scrollX || report.scrollY)
+        sendWheelEvent(QPoint(report.scrollX, report.scrollY));
+
+#ifndef QT_NO_GESTURES
+    if (report.pinch != QBsdTouchpad::NoPinch) {
+        QTouchDevice *device = 0;
+#if QT_VERSION >= QT_VERSION_CHECK(5, 10, 0)
+        // since 5.10 gestures name the device they come from
+        if (!m_touchDevice) {
+            m_touchDevice = new QTouchDevice;
+            m_touchDevice->setName(QFile::decodeName(m_device));
+            m_touchDevice->setType(QTouchDevice::TouchPad);
+            m_touchDevice->setCapabilities(QTouchDevice::Position);
+            QWindowSystemInterface::registerTouchDevice(m_touchDevice);
+        }
+        device = m_touchDevice;
+#endif
+        Qt::NativeGestureType type = Qt::ZoomNativeGesture;
+        if (report.pinch == QBsdTouchpad::PinchBegin)
+            type = Qt::BeginNativeGesture;
+        else if (report.pinch == QBsdTouchpad::PinchEnd)
+            type = Qt::EndNativeGesture;
+        const qreal value = type == Qt::ZoomNativeGesture ? report.zoom : 0;
+        m_eventQueue->postGestureEvent(clampedPosition(), type, value, device, m_clock.elapsed());
+    }
+#endif
+}
+
+QPoint QBsdMouseHandler::clampedPosition()
+{
     // clamp to screen geometry
-    QRect g = QGuiApplication::primaryScreen()->virtualGeometry();
+    QRect g = screenGeometry();
     if (m_x + m_xOffset < g.left())
         m_x = g.left() - m_xOffset;
     else if (m_x + m_xOffset > g.right())
@@ -155,16 +648,82 @@ void QBsdMouseHandler::readMouseData()
     else if (m_y + m_yOffset > g.bottom())
         m_y = g.bottom() - m_yOffset;
 
-    QPoint pos(m_x + m_xOffset, m_y + m_yOffset);
-    m_buttons = Qt::NoButton;
-    if (!(status & MOUSE_SYS_BUTTON1UP))
-        m_buttons |= Qt::LeftButton;
-    if (!(status & MOUSE_SYS_BUTTON2UP))
-        m_buttons |= Qt::MiddleButton;
-    if (!(status & MOUSE_SYS_BUTTON3UP))
-        m_buttons |= Qt::RightButton;
+    return QPoint(m_x + m_xOffset, m_y + m_yOffset);
+}
+
+QRect QBsdMouseHandler::screenGeometry() const
+{
+    return m_seat ? m_seat->geometry() : QGuiApplication::primaryScreen()->virtualGeometry();
+}
+
+void QBsdMouseHandler::sendMouseEvent()
+{
+    const QPoint pos = clampedPosition();
+    m_inputState->shared.publishPointer(pos.x(), pos.y(), quint32(m_buttons));
+
+    // a click moves the seat's keyboard focus; only presses count, not
+    // every motion event of a drag
+    if (m_seat && (m_buttons & ~m_sentButtons))
+        m_seat->pointerPressed(pos);
+
+    // a click ends the motion being predicted; start over from where it
+    // landed, so the next motion event cannot overshoot past it
+    if (m_predictor && m_buttons != m_sentButtons) {
+        m_predictor->reset();
+        m_predictor->addSample(pos, m_clock.nsecsElapsed());
+        m_correctionTimer->stop();
+    }
+    m_sentButtons = m_buttons;
 
-    QWindowSystemInterface::handleMouseEvent(0, pos, pos, m_buttons);
+    deliverMouseEvent(pos);
+}
+
+void QBsdMouseHandler::sendMotionEvent()
+{
+    if (!m_predictor) {
+        sendMouseEvent();
+        return;
+    }
+
+    // Button transitions always go out at the real position, through
+    // sendMouseEvent(), so clicks land where the device says.
+    const QPoint pos = clampedPosition();
+    // only the buttons changed, or nothing did
+    if (m_predictor->isAt(pos))
+        return;
+
+    m_inputState->shared.publishPointer(pos.x(), pos.y(), quint32(m_buttons));
+    m_predictor->addSample(pos, m_clock.nsecsElapsed());
+
+    const QRect g = screenGeometry();
+    const QPoint predicted = m_predictor->predict(pos);
+    deliverMouseEvent(QPoint(qBound(g.left(), predicted.x(), g.right()),
+                             qBound(g.top(), predicted.y(), g.bottom())));
+
+    m_correctionTimer->start(m_predictor->horizon());
+}
+
+Qt::KeyboardModifiers QBsdMouseHandler::keyboardModifiers() const
+{
+    const QAtomicInt &modifiers = m_seat ? m_seat->keyboardModifiers : m_inputState->keyboardModifiers;
+    return Qt::KeyboardModifiers(modifiers.loadAcquire());
+}
+
+void QBsdMouseHandler::deliverMouseEvent(const QPoint &pos)
+{
+    if (m_directCursor)
+        m_eventQueue->moveCursor(pos);
+
+    const Qt::KeyboardModifiers modifiers = keyboardModifiers();
+    QBSD_TRACE_MOUSE_EVENT(pos.x(), pos.y(), int(m_buttons));
+    m_inputState->recorder.record(QBsdFlightRecorder::MouseEvent, pos.x(), pos.y(), int(m_buttons));
+    m_eventQueue->postMouseEvent(pos, m_buttons, modifiers);
+}
+
+void QBsdMouseHandler::sendWheelEvent(const QPoint &angleDelta)
+{
+    const QPoint pos = clampedPosition();
+    m_eventQueue->postWheelEvent(pos, angleDelta, keyboardModifiers());
 }
 
 QT_END_NAMESPACE
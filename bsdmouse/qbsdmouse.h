@@ -34,10 +34,27 @@
 #define QBSDMOUSE_H
 
 #include <qobject.h>
+#include <QElapsedTimer>
+#include <QHash>
+#include <QPoint>
+
+#include "qbsdinputstate_p.h"
+#include "qbsdmousedecoder.h"
+#include "qbsdtouchpad.h"
 
 QT_BEGIN_NAMESPACE
 
 class QSocketNotifier;
+class QTouchDevice;
+class QBsdDeviceMonitor;
+class QThread;
+class QTimer;
+class QBsdMotionPredictor;
+class QBsdButtonEmulator;
+class QBsdEventQueue;
+class QBsdInjectionServer;
+class QBsdSeat;
+struct QBsdInputStats;
 
 class QBsdMouseHandler : public QObject
 {
@@ -48,6 +65,27 @@ public:
 
 private slots:
     void readMouseData();
+    void openDevice();
+    void closeDevice();
+    void detachFromThread();
+    void sendMouseEvent();
+    void injectInput(int client, const QByteArray &data);
+    void injectionClientClosed(int client);
+    void expireButtonEmulation();
+
+private:
+    bool setupLevel(const QByteArray &device, bool native);
+    bool setupSerial(const QByteArray &device, int baud);
+    void processInput(QBsdMouseDecoder *decoder, QBsdTouchpad *touchpad, const quint8 *data, int size);
+    void processPacket(const QBsdMouseDecoder::Packet &packet);
+    void processTouchpadReport(const QBsdTouchpad::Report &report);
+    void updateButtons(Qt::MouseButtons buttons);
+    QRect screenGeometry() const;
+    QPoint clampedPosition();
+    void sendMotionEvent();
+    Qt::KeyboardModifiers keyboardModifiers() const;
+    void deliverMouseEvent(const QPoint &pos);
+    void sendWheelEvent(const QPoint &angleDelta);
 
 private:
     QScopedPointer<QSocketNotifier> m_notifier;
@@ -56,6 +94,56 @@ private:
     int m_x, m_y;
     int m_xOffset, m_yOffset;
     Qt::MouseButtons m_buttons;
+    Qt::MouseButtons m_sentButtons; // as of the last sendMouseEvent()
+    Qt::MouseButtons m_rawButtons;  // as the device reports them
+    QBsdInputState *m_inputState;
+    QBsdMouseDecoder m_decoder;
+    QScopedPointer<QBsdTouchpad> m_touchpad;
+    QTouchDevice *m_touchDevice;    // source of pinch gestures, from Qt 5.10
+    QElapsedTimer m_clock;
+
+    // device configuration from the spec, kept for reopening
+    QByteArray m_device;
+    bool m_native;
+    QBsdMouseDecoder::Protocol m_protocol;
+    int m_baud;
+
+    // spec option "hotplug": the device is opened whenever it is present
+    QBsdDeviceMonitor *m_monitor;
+    QTimer *m_openRetryTimer;
+    int m_openRetries;
+
+    // optional dedicated reader thread (spec option "thread")
+    QThread *m_thread;
+
+    // optional position prediction (spec option "predict[=ms]")
+    QScopedPointer<QBsdMotionPredictor> m_predictor;
+    QTimer *m_correctionTimer;
+
+    // holds and coalesces events while the GUI thread lags behind
+    QBsdEventQueue *m_eventQueue;
+
+    // spec option "inject=<socket>"
+    QBsdInjectionServer *m_injectionServer;
+    struct InjectClient {
+        QBsdMouseDecoder decoder;               // each client's bytes frame separately
+        QScopedPointer<QBsdTouchpad> touchpad;
+    };
+    QHash<int, InjectClient *> m_injectClients;
+
+    // spec option "cursor": move the platform cursor as soon as the GUI
+    // thread runs, ahead of the mouse events still waiting for delivery
+    bool m_directCursor;
+
+    // spec options "seat=<name>" and "screen=<name|index>"
+    QBsdSeat *m_seat;
+
+    // spec option "emulate3[=ms]": left+right is the middle button
+    QScopedPointer<QBsdButtonEmulator> m_buttonEmulator;
+    QTimer *m_emulationTimer;
+
+    // exported when QT_BSD_INPUT_METRICS is set
+    QBsdInputStats *m_stats;
 };
 
 QT_END_NAMESPACE
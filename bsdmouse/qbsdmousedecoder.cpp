@@ -0,0 +1,191 @@
+/****************************************************************************
+**
+** Copyright (C) 2015-2016 Oleksandr Tymoshenko <gonzo@bluezbox.com>
+**
+** This file is part of the QtGui module of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:LGPL21$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see http://www.qt.io/terms-conditions. For further
+** information use the contact form at http://www.qt.io/contact-us.
+**
+** GNU Lesser General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU Lesser
+** General Public License version 2.1 or version 3 as published by the Free
+** Software Foundation and appearing in the file LICENSE.LGPLv21 and
+** LICENSE.LGPLv3 included in the packaging of this file. Please review the
+** following information to ensure the GNU Lesser General Public License
+** requirements will be met: https://www.gnu.org/licenses/lgpl.html and
+** http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+**
+** As a special exception, The Qt Company gives you certain additional
+** rights. These rights are described in The Qt Company LGPL Exception
+** version 1.1, included in the file LGPL_EXCEPTION.txt in this package.
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+#include "qbsdmousedecoder.h"
+
+#include <string.h>
+#include <sys/mouse.h>
+
+QT_BEGIN_NAMESPACE
+
+QBsdMouseDecoder::QBsdMouseDecoder(Protocol protocol) :
+    m_protocol(NoProtocol),
+    m_size(0),
+    m_length(0),
+    m_synced(true),
+    m_framingErrors(0)
+{
+    setProtocol(protocol);
+}
+
+void QBsdMouseDecoder::setProtocol(Protocol protocol)
+{
+    static const int sizes[] = { 0, MOUSE_MSC_PACKETSIZE, MOUSE_SYS_PACKETSIZE, MOUSE_PS2_PACKETSIZE, 4 };
+
+    m_protocol = protocol;
+    m_size = sizes[protocol];
+    m_length = 0;
+    m_synced = true;
+}
+
+QBsdMouseDecoder::Protocol QBsdMouseDecoder::protocolFromName(const QString &name)
+{
+    if (name == QLatin1String("msc") || name == QLatin1String("mousesystems"))
+        return MouseSystems;
+    if (name == QLatin1String("ps2") || name == QLatin1String("ps/2"))
+        return Ps2;
+    if (name == QLatin1String("imps2") || name == QLatin1String("intellimouse"))
+        return IntelliMouse;
+    return NoProtocol;
+}
+
+bool QBsdMouseDecoder::isSync(quint8 byte) const
+{
+    switch (m_protocol) {
+    case MouseSystems:
+    case SysMouse:
+        return (byte & MOUSE_SYS_SYNCMASK) == MOUSE_SYS_SYNC;
+    case Ps2:
+    case IntelliMouse:
+        // bit 3 is always set, overflow bits are never set in sane data
+        return (byte & 0xc8) == 0x08;
+    default:
+        return false;
+    }
+}
+
+bool QBsdMouseDecoder::isValid() const
+{
+    if (!m_synced && (m_protocol == MouseSystems || m_protocol == SysMouse)) {
+        // Deltas of -128 to -121 look like sync bytes. In a stream we are
+        // locked onto they are just fast motion, but while looking for the
+        // packet boundary a candidate holding one most likely started on a
+        // delta, so try the next one.
+        for (int i = 1; i <= 4; ++i) {
+            if (isSync(m_buffer[i]))
+                return false;
+        }
+    }
+    // the extension bytes of sysmouse packets never have bit 7 set
+    if (m_protocol == SysMouse)
+        return !((m_buffer[5] | m_buffer[6] | m_buffer[7]) & 0x80);
+    return true;
+}
+
+void QBsdMouseDecoder::resync()
+{
+    int skip = 1;
+    while (skip < m_length && !isSync(m_buffer[skip]))
+        ++skip;
+
+    m_length -= skip;
+    memmove(m_buffer, m_buffer + skip, m_length);
+}
+
+bool QBsdMouseDecoder::push(quint8 byte, Packet *packet)
+{
+    if (m_length == 0 && !isSync(byte)) {
+        // count a run of garbage once
+        if (m_synced) {
+            ++m_framingErrors;
+            m_synced = false;
+        }
+        return false;
+    }
+
+    m_buffer[m_length++] = byte;
+    if (m_length < m_size)
+        return false;
+
+    if (!isValid()) {
+        if (m_synced) {
+            ++m_framingErrors;
+            m_synced = false;
+        }
+        resync();
+        return false;
+    }
+
+    m_length = 0;
+    m_synced = true;
+    decode(packet);
+    return true;
+}
+
+void QBsdMouseDecoder::decode(Packet *packet) const
+{
+    const quint8 *p = m_buffer;
+
+    packet->dz = 0;
+    packet->buttons = Qt::NoButton;
+
+    // packet formats described in mouse(4) and psm(4)
+    switch (m_protocol) {
+    case SysMouse:
+        // 7-bit signed Z deltas, active low buttons 4 to 10
+        packet->dz = -(qint8(p[5] << 1) / 2 + qint8(p[6] << 1) / 2);
+        if (!(p[7] & 0x01))
+            packet->buttons |= Qt::ExtraButton1;
+        if (!(p[7] & 0x02))
+            packet->buttons |= Qt::ExtraButton2;
+        // fall through
+    case MouseSystems:
+        // buttons are active low, Y grows upwards
+        packet->dx = qint8(p[1]) + qint8(p[3]);
+        packet->dy = -(qint8(p[2]) + qint8(p[4]));
+        if (!(p[0] & 0x04))
+            packet->buttons |= Qt::LeftButton;
+        if (!(p[0] & 0x02))
+            packet->buttons |= Qt::MiddleButton;
+        if (!(p[0] & 0x01))
+            packet->buttons |= Qt::RightButton;
+        break;
+    case IntelliMouse:
+        packet->dz = -qint8(p[3]);
+        // fall through
+    case Ps2:
+        // 9-bit two's complement deltas, sign bits in the first byte
+        packet->dx = p[1] - ((p[0] & 0x10) << 4);
+        packet->dy = -(p[2] - ((p[0] & 0x20) << 3));
+        if (p[0] & 0x01)
+            packet->buttons |= Qt::LeftButton;
+        if (p[0] & 0x02)
+            packet->buttons |= Qt::RightButton;
+        if (p[0] & 0x04)
+            packet->buttons |= Qt::MiddleButton;
+        break;
+    default:
+        packet->dx = packet->dy = 0;
+        break;
+    }
+}
+
+QT_END_NAMESPACE
@@ -0,0 +1,92 @@
+/****************************************************************************
+**
+** Copyright (C) 2015-2016 Oleksandr Tymoshenko <gonzo@bluezbox.com>
+**
+** This file is part of the QtGui module of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:LGPL21$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see http://www.qt.io/terms-conditions. For further
+** information use the contact form at http://www.qt.io/contact-us.
+**
+** GNU Lesser General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU Lesser
+** General Public License version 2.1 or version 3 as published by the Free
+** Software Foundation and appearing in the file LICENSE.LGPLv21 and
+** LICENSE.LGPLv3 included in the packaging of this file. Please review the
+** following information to ensure the GNU Lesser General Public License
+** requirements will be met: https://www.gnu.org/licenses/lgpl.html and
+** http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+**
+** As a special exception, The Qt Company gives you certain additional
+** rights. These rights are described in The Qt Company LGPL Exception
+** version 1.1, included in the file LGPL_EXCEPTION.txt in this package.
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+#ifndef QBSDMOUSEDECODER_H
+#define QBSDMOUSEDECODER_H
+
+#include <QString>
+#include <QtCore/qnamespace.h>
+
+QT_BEGIN_NAMESPACE
+
+// Streaming framer and decoder for sysmouse(4) and for the byte protocols
+// spoken by mice opened directly, without moused in between. Bytes are
+// pushed one at a time; a packet is only decoded once it starts with a
+// valid sync byte, is complete and passes the protocol's checks. A packet
+// failing them is rescanned for the next sync byte, so a lost byte costs
+// at most one packet.
+class QBsdMouseDecoder
+{
+public:
+    enum Protocol {
+        NoProtocol,
+        MouseSystems,   // 5 bytes, also sysmouse(4) level 0
+        SysMouse,       // 8 bytes, sysmouse(4) level 1
+        Ps2,            // 3 bytes, psm(4) native level
+        IntelliMouse    // 4 bytes, PS/2 with wheel
+    };
+
+    struct Packet {
+        int dx, dy;                 // screen orientation
+        int dz;                     // wheel, positive when rotated away from the user
+        Qt::MouseButtons buttons;
+    };
+
+    explicit QBsdMouseDecoder(Protocol protocol = NoProtocol);
+
+    void setProtocol(Protocol protocol);
+    Protocol protocol() const { return m_protocol; }
+    int packetSize() const { return m_size; }
+
+    static Protocol protocolFromName(const QString &name);
+
+    bool push(quint8 byte, Packet *packet);
+
+    // number of times the stream lost packet alignment
+    quint64 framingErrors() const { return m_framingErrors; }
+
+private:
+    bool isSync(quint8 byte) const;
+    bool isValid() const;
+    void resync();
+    void decode(Packet *packet) const;
+
+    Protocol m_protocol;
+    int m_size;
+    int m_length;
+    bool m_synced;
+    quint64 m_framingErrors;
+    quint8 m_buffer[8];
+};
+
+QT_END_NAMESPACE
+
+#endif // QBSDMOUSEDECODER_H
@@ -0,0 +1,251 @@
+/****************************************************************************
+**
+** Copyright (C) 2015-2016 Oleksandr Tymoshenko <gonzo@bluezbox.com>
+**
+** This file is part of the QtGui module of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:LGPL21$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see http://www.qt.io/terms-conditions. For further
+** information use the contact form at http://www.qt.io/contact-us.
+**
+** GNU Lesser General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU Lesser
+** General Public License version 2.1 or version 3 as published by the Free
+** Software Foundation and appearing in the file LICENSE.LGPLv21 and
+** LICENSE.LGPLv3 included in the packaging of this file. Please review the
+** following information to ensure the GNU Lesser General Public License
+** requirements will be met: https://www.gnu.org/licenses/lgpl.html and
+** http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+**
+** As a special exception, The Qt Company gives you certain additional
+** rights. These rights are described in The Qt Company LGPL Exception
+** version 1.1, included in the file LGPL_EXCEPTION.txt in this package.
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+#include "qbsdtouchpad.h"
+
+#include <QtCore/qmath.h>
+
+#include <string.h>
+
+QT_BEGIN_NAMESPACE
+
+enum {
+    TouchPressure = 30,          // Z at which a finger counts as touching
+    UnitsPerPixel = 4,
+    ScrollUnitsPerNotch = 160,
+    TapTimeout = 180,            // ms
+    TapTravel = 64,              // pad units
+    PinchThreshold = 200         // pad units of finger distance change
+};
+
+QBsdTouchpad::QBsdTouchpad() :
+    m_touching(false),
+    m_fingers(0),
+    m_maxFingers(0),
+    m_lastX(0),
+    m_lastY(0),
+    m_travel(0),
+    m_touchStart(0),
+    m_hasSecondary(false),
+    m_secondaryX(0),
+    m_secondaryY(0),
+    m_pinching(false),
+    m_startDistance(-1),
+    m_lastDistance(-1),
+    m_remainderX(0),
+    m_remainderY(0),
+    m_scrollRemainderX(0),
+    m_scrollRemainderY(0),
+    m_length(0),
+    m_synced(true),
+    m_framingErrors(0)
+{
+}
+
+// the first and fourth byte of every W mode packet carry fixed bits
+static inline bool isFirstByte(quint8 byte)
+{
+    return (byte & 0xc8) == 0x80;
+}
+
+static inline bool isFourthByte(quint8 byte)
+{
+    return (byte & 0xc8) == 0xc0;
+}
+
+void QBsdTouchpad::resync()
+{
+    if (m_synced) {
+        ++m_framingErrors;
+        m_synced = false;
+    }
+
+    // rescan what we have for the next candidate that still fits
+    do {
+        int skip = 1;
+        while (skip < m_length && !isFirstByte(m_buffer[skip]))
+            ++skip;
+        m_length -= skip;
+        memmove(m_buffer, m_buffer + skip, m_length);
+    } while (m_length > 3 && !isFourthByte(m_buffer[3]));
+}
+
+bool QBsdTouchpad::push(quint8 byte, qint64 timestamp, Report *report)
+{
+    if (m_length == 0 && !isFirstByte(byte)) {
+        // count a run of garbage once
+        if (m_synced) {
+            ++m_framingErrors;
+            m_synced = false;
+        }
+        return false;
+    }
+
+    m_buffer[m_length++] = byte;
+    if (m_length == 4 && !isFourthByte(byte)) {
+        resync();
+        return false;
+    }
+    if (m_length < PacketSize)
+        return false;
+
+    m_length = 0;
+    m_synced = true;
+    return processPacket(m_buffer, timestamp, report);
+}
+
+void QBsdTouchpad::reset(int x, int y, int fingers)
+{
+    m_fingers = fingers;
+    m_lastX = x;
+    m_lastY = y;
+    m_remainderX = m_remainderY = 0;
+    m_scrollRemainderX = m_scrollRemainderY = 0;
+    m_startDistance = -1;
+}
+
+// packet layout of the Synaptics TouchPad Interfacing Guide, W mode
+bool QBsdTouchpad::processPacket(const quint8 *p, qint64 timestamp, Report *report)
+{
+    if ((p[0] & 0xc8) != 0x80 || (p[3] & 0xc8) != 0xc0)
+        return false;
+
+    const int w = ((p[0] & 0x30) >> 2) | ((p[0] & 0x04) >> 1) | ((p[3] & 0x04) >> 2);
+    if (w == 2) {
+        // advanced gesture mode: second finger at half resolution
+        m_secondaryX = (((p[4] & 0x0f) << 8) | p[1]) << 1;
+        m_secondaryY = (((p[4] & 0xf0) << 4) | p[2]) << 1;
+        m_hasSecondary = true;
+        return false;
+    }
+
+    const int x = ((p[3] & 0x10) << 8) | ((p[1] & 0x0f) << 8) | p[4];
+    const int y = ((p[3] & 0x20) << 7) | ((p[1] & 0xf0) << 4) | p[5];
+    const int z = p[2];
+
+    int fingers = 0;
+    if (z >= TouchPressure)
+        fingers = (w == 0) ? 2 : (w == 1) ? 3 : 1;
+
+    report->dx = report->dy = 0;
+    report->scrollX = report->scrollY = 0;
+    report->buttons = Qt::NoButton;
+    if (p[0] & 0x01)
+        report->buttons |= Qt::LeftButton;
+    if (p[0] & 0x02)
+        report->buttons |= Qt::RightButton;
+    report->tap = Qt::NoButton;
+    report->pinch = NoPinch;
+    report->zoom = 0;
+
+    if (!fingers) {
+        if (m_touching) {
+            if (m_pinching)
+                report->pinch = PinchEnd;
+            else if (timestamp - m_touchStart <= TapTimeout && m_travel <= TapTravel
+                     && report->buttons == Qt::NoButton)
+                report->tap = (m_maxFingers == 1) ? Qt::LeftButton
+                            : (m_maxFingers == 2) ? Qt::RightButton : Qt::MiddleButton;
+        }
+        m_touching = false;
+        m_pinching = false;
+        m_hasSecondary = false;
+        return true;
+    }
+
+    if (!m_touching) {
+        m_touching = true;
+        m_touchStart = timestamp;
+        m_travel = 0;
+        m_maxFingers = fingers;
+        reset(x, y, fingers);
+        return true;
+    }
+
+    // the reported position jumps when fingers are added or lifted
+    if (fingers != m_fingers) {
+        if (m_pinching && fingers != 2) {
+            report->pinch = PinchEnd;
+            m_pinching = false;
+        }
+        m_maxFingers = qMax(m_maxFingers, fingers);
+        reset(x, y, fingers);
+        return true;
+    }
+
+    const int dx = x - m_lastX;
+    const int dy = y - m_lastY;
+    m_lastX = x;
+    m_lastY = y;
+    m_travel += qAbs(dx) + qAbs(dy);
+
+    if (fingers == 1) {
+        // pad Y grows upwards
+        m_remainderX += dx;
+        m_remainderY -= dy;
+        report->dx = m_remainderX / UnitsPerPixel;
+        report->dy = m_remainderY / UnitsPerPixel;
+        m_remainderX -= report->dx * UnitsPerPixel;
+        m_remainderY -= report->dy * UnitsPerPixel;
+    } else if (fingers == 2) {
+        if (m_hasSecondary) {
+            const int sx = x - m_secondaryX;
+            const int sy = y - m_secondaryY;
+            const qreal distance = qSqrt(qreal(sx * sx + sy * sy));
+            if (m_pinching) {
+                if (m_lastDistance > 0) {
+                    report->pinch = PinchUpdate;
+                    report->zoom = distance / m_lastDistance - 1;
+                }
+                m_lastDistance = distance;
+            } else if (m_startDistance < 0) {
+                m_startDistance = distance;
+            } else if (qAbs(distance - m_startDistance) > PinchThreshold) {
+                m_pinching = true;
+                m_lastDistance = distance;
+                report->pinch = PinchBegin;
+            }
+        }
+
+        if (!m_pinching) {
+            m_scrollRemainderX += dx * 120;
+            m_scrollRemainderY += dy * 120;
+            report->scrollX = m_scrollRemainderX / ScrollUnitsPerNotch;
+            report->scrollY = m_scrollRemainderY / ScrollUnitsPerNotch;
+            m_scrollRemainderX -= report->scrollX * ScrollUnitsPerNotch;
+            m_scrollRemainderY -= report->scrollY * ScrollUnitsPerNotch;
+        }
+    }
+
+    return true;
+}
+
+QT_END_NAMESPACE
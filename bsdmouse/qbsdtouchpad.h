@@ -0,0 +1,109 @@
+/****************************************************************************
+**
+** Copyright (C) 2015-2016 Oleksandr Tymoshenko <gonzo@bluezbox.com>
+**
+** This file is part of the QtGui module of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:LGPL21$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see http://www.qt.io/terms-conditions. For further
+** information use the contact form at http://www.qt.io/contact-us.
+**
+** GNU Lesser General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU Lesser
+** General Public License version 2.1 or version 3 as published by the Free
+** Software Foundation and appearing in the file LICENSE.LGPLv21 and
+** LICENSE.LGPLv3 included in the packaging of this file. Please review the
+** following information to ensure the GNU Lesser General Public License
+** requirements will be met: https://www.gnu.org/licenses/lgpl.html and
+** http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+**
+** As a special exception, The Qt Company gives you certain additional
+** rights. These rights are described in The Qt Company LGPL Exception
+** version 1.1, included in the file LGPL_EXCEPTION.txt in this package.
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+#ifndef QBSDTOUCHPAD_H
+#define QBSDTOUCHPAD_H
+
+#include <QtGlobal>
+#include <QtCore/qnamespace.h>
+
+QT_BEGIN_NAMESPACE
+
+// Decodes Synaptics absolute-mode packets as delivered by psm(4) at
+// native operation level and turns them into pointer motion, taps,
+// two-finger scrolling and pinch. Every packet is handled in constant
+// time; no history beyond the previous contact is kept.
+class QBsdTouchpad
+{
+public:
+    enum { PacketSize = 6 };
+
+    enum PinchPhase {
+        NoPinch,
+        PinchBegin,
+        PinchUpdate,
+        PinchEnd
+    };
+
+    struct Report {
+        int dx, dy;                 // pointer motion in pixels, screen orientation
+        int scrollX, scrollY;       // wheel angle delta, 120 per notch
+        Qt::MouseButtons buttons;   // physical buttons
+        Qt::MouseButton tap;        // button to click for a tap, Qt::NoButton if none
+        PinchPhase pinch;
+        qreal zoom;                 // relative scale change for PinchUpdate
+    };
+
+    QBsdTouchpad();
+
+    // Returns false if the packet fails the Synaptics sync check or
+    // only carries secondary finger data.
+    bool processPacket(const quint8 *packet, qint64 timestamp, Report *report);
+
+    // Frames a byte stream that need not be packet aligned, like
+    // QBsdMouseDecoder; returns true when a packet produced a report.
+    bool push(quint8 byte, qint64 timestamp, Report *report);
+
+    // number of times the stream lost packet alignment
+    quint64 framingErrors() const { return m_framingErrors; }
+
+private:
+    void reset(int x, int y, int fingers);
+    void resync();
+
+    bool m_touching;
+    int m_fingers;
+    int m_maxFingers;
+    int m_lastX, m_lastY;
+    int m_travel;
+    qint64 m_touchStart;
+
+    bool m_hasSecondary;
+    int m_secondaryX, m_secondaryY;
+
+    bool m_pinching;
+    qreal m_startDistance;
+    qreal m_lastDistance;
+
+    // sub-pixel remainders carried between packets
+    int m_remainderX, m_remainderY;
+    int m_scrollRemainderX, m_scrollRemainderY;
+
+    // framing state of push()
+    quint8 m_buffer[PacketSize];
+    int m_length;
+    bool m_synced;
+    quint64 m_framingErrors;
+};
+
+QT_END_NAMESPACE
+
+#endif // QBSDTOUCHPAD_H
@@ -1,3 +1,3 @@
 TEMPLATE = subdirs
 
-SUBDIRS += bsdkeyboard bsdmouse
+SUBDIRS += bsdkeyboard bsdmouse tools tests
@@ -0,0 +1,177 @@
+/****************************************************************************
+**
+** Copyright (C) 2015-2016 Oleksandr Tymoshenko <gonzo@bluezbox.com>
+**
+** This file is part of the QtGui module of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:LGPL21$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see http://www.qt.io/terms-conditions. For further
+** information use the contact form at http://www.qt.io/contact-us.
+**
+** GNU Lesser General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU Lesser
+** General Public License version 2.1 or version 3 as published by the Free
+** Software Foundation and appearing in the file LICENSE.LGPLv21 and
+** LICENSE.LGPLv3 included in the packaging of this file. Please review the
+** following information to ensure the GNU Lesser General Public License
+** requirements will be met: https://www.gnu.org/licenses/lgpl.html and
+** http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+**
+** As a special exception, The Qt Company gives you certain additional
+** rights. These rights are described in The Qt Company LGPL Exception
+** version 1.1, included in the file LGPL_EXCEPTION.txt in this package.
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+#include "qbsddevicemonitor_p.h"
+
+#include <QFile>
+#include <QFileInfo>
+#include <QFileSystemWatcher>
+#include <QList>
+#include <QSocketNotifier>
+#include <private/qcore_unix_p.h>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+QT_BEGIN_NAMESPACE
+
+static const char s_devdSocket[] = "/var/run/devd.seqpacket.pipe";
+
+QBsdDeviceMonitor::QBsdDeviceMonitor(const QString &device, QObject *parent) :
+    QObject(parent),
+    m_device(device),
+    m_present(QFile::exists(device)),
+    m_devdFd(-1),
+    m_devdNotifier(0),
+    m_watcher(0)
+{
+    if (device.startsWith(QLatin1String("/dev/")))
+        m_cdev = QFile::encodeName(device.mid(5));
+
+    if (!connectDevd())
+        watchDirectory();
+}
+
+QBsdDeviceMonitor::~QBsdDeviceMonitor()
+{
+    disconnectDevd();
+}
+
+bool QBsdDeviceMonitor::connectDevd()
+{
+    QByteArray path = qgetenv("QT_BSD_DEVD_SOCKET");
+    if (path.isEmpty())
+        path = QByteArray(s_devdSocket);
+
+    struct sockaddr_un addr;
+    if (m_cdev.isEmpty() || size_t(path.size()) >= sizeof(addr.sun_path))
+        return false;
+
+    m_devdFd = ::socket(AF_UNIX, SOCK_SEQPACKET, 0);
+    if (m_devdFd < 0)
+        return false;
+
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    memcpy(addr.sun_path, path.constData(), path.size());
+
+    if (::connect(m_devdFd, reinterpret_cast<struct sockaddr *>(&addr), sizeof(addr)) < 0) {
+        qt_safe_close(m_devdFd);
+        m_devdFd = -1;
+        return false;
+    }
+    fcntl(m_devdFd, F_SETFL, O_NONBLOCK);
+
+    m_devdNotifier = new QSocketNotifier(m_devdFd, QSocketNotifier::Read, this);
+    connect(m_devdNotifier, SIGNAL(activated(int)), this, SLOT(readDevdEvents()));
+    return true;
+}
+
+void QBsdDeviceMonitor::disconnectDevd()
+{
+    delete m_devdNotifier;
+    m_devdNotifier = 0;
+
+    if (m_devdFd >= 0) {
+        qt_safe_close(m_devdFd);
+        m_devdFd = -1;
+    }
+}
+
+void QBsdDeviceMonitor::watchDirectory()
+{
+    // inotify on Linux, kqueue on the BSDs
+    m_watcher = new QFileSystemWatcher(QStringList(QFileInfo(m_device).absolutePath()), this);
+    connect(m_watcher, SIGNAL(directoryChanged(QString)), this, SLOT(directoryChanged()));
+}
+
+void QBsdDeviceMonitor::readDevdEvents()
+{
+    char buffer[1024];
+
+    forever {
+        const ssize_t size = ::recv(m_devdFd, buffer, sizeof(buffer) - 1, 0);
+        if (size < 0 && errno == EINTR)
+            continue;
+        if (size < 0 && errno == EAGAIN)
+            return;
+        if (size <= 0) {
+            // devd went away, keep going without it
+            disconnectDevd();
+            watchDirectory();
+            setPresent(QFile::exists(m_device));
+            return;
+        }
+
+        // e.g. "!system=DEVFS subsystem=CDEV type=CREATE cdev=ukbd0"
+        const QByteArray message = QByteArray(buffer, int(size)).trimmed();
+        if (!message.startsWith("!system=DEVFS"))
+            continue;
+
+        bool matches = false;
+        int type = 0;
+        const QList<QByteArray> fields = message.split(' ');
+        for (const QByteArray &field : fields) {
+            if (field == "type=CREATE")
+                type = 1;
+            else if (field == "type=DESTROY")
+                type = -1;
+            else if (field.startsWith("cdev="))
+                matches = (field.mid(5) == m_cdev);
+        }
+
+        if (matches && type)
+            setPresent(type > 0);
+    }
+}
+
+void QBsdDeviceMonitor::directoryChanged()
+{
+    setPresent(QFile::exists(m_device));
+}
+
+void QBsdDeviceMonitor::setPresent(bool present)
+{
+    if (present == m_present)
+        return;
+
+    m_present = present;
+    if (present)
+        emit deviceAdded();
+    else
+        emit deviceRemoved();
+}
+
+QT_END_NAMESPACE
@@ -0,0 +1,90 @@
+/****************************************************************************
+**
+** Copyright (C) 2015-2016 Oleksandr Tymoshenko <gonzo@bluezbox.com>
+**
+** This file is part of the QtGui module of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:LGPL21$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see http://www.qt.io/terms-conditions. For further
+** information use the contact form at http://www.qt.io/contact-us.
+**
+** GNU Lesser General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU Lesser
+** General Public License version 2.1 or version 3 as published by the Free
+** Software Foundation and appearing in the file LICENSE.LGPLv21 and
+** LICENSE.LGPLv3 included in the packaging of this file. Please review the
+** following information to ensure the GNU Lesser General Public License
+** requirements will be met: https://www.gnu.org/licenses/lgpl.html and
+** http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+**
+** As a special exception, The Qt Company gives you certain additional
+** rights. These rights are described in The Qt Company LGPL Exception
+** version 1.1, included in the file LGPL_EXCEPTION.txt in this package.
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+#ifndef QBSDDEVICEMONITOR_P_H
+#define QBSDDEVICEMONITOR_P_H
+
+//
+//  W A R N I N G
+//  -------------
+//
+// This file is not part of the Qt API.  It exists purely as an
+// implementation detail.  This header file may change from version to
+// version without notice, or even be removed.
+//
+// We mean it.
+//
+
+#include <QObject>
+#include <QString>
+
+QT_BEGIN_NAMESPACE
+
+class QSocketNotifier;
+class QFileSystemWatcher;
+
+// Tells when a device node appears or goes away. DEVFS notifications are
+// taken from devd(8)'s seqpacket socket; QT_BSD_DEVD_SOCKET names another
+// socket speaking the same protocol. Without devd the directory holding
+// the node is watched instead.
+class QBsdDeviceMonitor : public QObject
+{
+    Q_OBJECT
+public:
+    explicit QBsdDeviceMonitor(const QString &device, QObject *parent = 0);
+    ~QBsdDeviceMonitor() override;
+
+signals:
+    void deviceAdded();
+    void deviceRemoved();
+
+private slots:
+    void readDevdEvents();
+    void directoryChanged();
+
+private:
+    bool connectDevd();
+    void disconnectDevd();
+    void watchDirectory();
+    void setPresent(bool present);
+
+    QString m_device;
+    QByteArray m_cdev;      // node name relative to /dev, as devd reports it
+    bool m_present;
+
+    int m_devdFd;
+    QSocketNotifier *m_devdNotifier;
+    QFileSystemWatcher *m_watcher;
+};
+
+QT_END_NAMESPACE
+
+#endif // QBSDDEVICEMONITOR_P_H
@@ -0,0 +1,331 @@
+/****************************************************************************
+**
+** Copyright (C) 2015-2016 Oleksandr Tymoshenko <gonzo@bluezbox.com>
+**
+** This file is part of the QtGui module of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:LGPL21$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see http://www.qt.io/terms-conditions. For further
+** information use the contact form at http://www.qt.io/contact-us.
+**
+** GNU Lesser General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU Lesser
+** General Public License version 2.1 or version 3 as published by the Free
+** Software Foundation and appearing in the file LICENSE.LGPLv21 and
+** LICENSE.LGPLv3 included in the packaging of this file. Please review the
+** following information to ensure the GNU Lesser General Public License
+** requirements will be met: https://www.gnu.org/licenses/lgpl.html and
+** http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+**
+** As a special exception, The Qt Company gives you certain additional
+** rights. These rights are described in The Qt Company LGPL Exception
+** version 1.1, included in the file LGPL_EXCEPTION.txt in this package.
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+#include "qbsdeventqueue_p.h"
+#include "qbsdinputstats_p.h"
+#include "qbsdseat_p.h"
+
+#include <QGuiApplication>
+#include <QInputMethodEvent>
+#include <QMutexLocker>
+#include <QScreen>
+#include <QTimer>
+#include <QTouchDevice>
+#include <QWindow>
+#include <qpa/qplatformcursor.h>
+#include <qpa/qplatformscreen.h>
+#include <qpa/qwindowsysteminterface.h>
+
+QT_BEGIN_NAMESPACE
+
+enum {
+    BackedUpThreshold = 32, // window system events not yet processed by the GUI thread
+    Capacity = 256,
+    RetryInterval = 4       // ms
+};
+
+QBsdEventQueue::QBsdEventQueue(QObject *parent) :
+    QObject(parent),
+    m_seat(0),
+    m_stats(0),
+    m_buttons(Qt::NoButton),
+    m_retryTimer(new QTimer(this)),
+    m_coalesced(0),
+    m_guiSendsInFlight(new QAtomicInt(0)),
+    m_cursorMove(new CursorMove)
+{
+    m_cursorMove->pending = false;
+
+    m_retryTimer->setSingleShot(true);
+    m_retryTimer->setInterval(RetryInterval);
+    connect(m_retryTimer, SIGNAL(timeout()), this, SLOT(flush()));
+}
+
+bool QBsdEventQueue::isBackedUp() const
+{
+    return QWindowSystemInterface::windowSystemEventsQueued() > BackedUpThreshold;
+}
+
+void QBsdEventQueue::postMouseEvent(const QPoint &pos, Qt::MouseButtons buttons, Qt::KeyboardModifiers modifiers)
+{
+    Event event;
+    event.type = Event::Mouse;
+    event.pos = pos;
+    event.buttons = buttons;
+    event.modifiers = modifiers;
+    event.transition = buttons != m_buttons;
+    m_buttons = buttons;
+    post(event);
+}
+
+void QBsdEventQueue::postWheelEvent(const QPoint &pos, const QPoint &angleDelta, Qt::KeyboardModifiers modifiers)
+{
+    Event event;
+    event.type = Event::Wheel;
+    event.pos = pos;
+    event.angleDelta = angleDelta;
+    event.modifiers = modifiers;
+    post(event);
+}
+
+void QBsdEventQueue::postKeyEvent(int nativecode, const QString &text, int qtcode, Qt::KeyboardModifiers modifiers,
+                                  bool isPress, bool autoRepeat)
+{
+    Event event;
+    event.type = Event::Key;
+    event.nativecode = nativecode;
+    event.text = text;
+    event.qtcode = qtcode;
+    event.modifiers = modifiers;
+    event.isPress = isPress;
+    event.autoRepeat = autoRepeat;
+    post(event);
+}
+
+void QBsdEventQueue::postCommit(const QString &text)
+{
+    Event event;
+    event.type = Event::Commit;
+    event.text = text;
+    post(event);
+}
+
+#ifndef QT_NO_GESTURES
+void QBsdEventQueue::postGestureEvent(const QPoint &pos, Qt::NativeGestureType type, qreal value,
+                                      QTouchDevice *device, ulong timestamp)
+{
+    Event event;
+    event.type = Event::Gesture;
+    event.pos = pos;
+    event.gesture = type;
+    event.value = value;
+    event.device = device;
+    event.timestamp = timestamp;
+    post(event);
+}
+#endif
+
+void QBsdEventQueue::moveCursor(const QPoint &pos)
+{
+    QSharedPointer<CursorMove> move = m_cursorMove;
+    QMutexLocker locker(&move->mutex);
+    move->pos = pos;
+    if (move->pending)
+        return;
+    move->pending = true;
+
+    // the cursor belongs to the GUI thread; its software variants repaint
+    QBsdSeat *seat = m_seat;
+    QTimer::singleShot(0, qApp, [move, seat]() {
+        QMutexLocker locker(&move->mutex);
+        const QPoint pos = move->pos;
+        move->pending = false;
+        locker.unlock();
+
+        QScreen *screen = seat ? seat->screen() : QGuiApplication::primaryScreen();
+        if (QPlatformCursor *cursor = screen ? screen->handle()->cursor() : 0)
+            cursor->setPos(pos);
+    });
+}
+
+void QBsdEventQueue::post(const Event &event)
+{
+    // the common case: nothing held and the GUI thread keeps up
+    if (m_events.isEmpty() && !isHeld()) {
+        deliver(event);
+        return;
+    }
+
+    if (coalesce(event)) {
+        ++m_coalesced;
+        // a merged key event is a repeat that never gets delivered
+        if (m_stats)
+            m_stats->add(event.type == Event::Key ? QBsdInputStats::Dropped : QBsdInputStats::Coalesced);
+    } else {
+        if (m_events.size() >= Capacity) {
+            if (m_stats)
+                m_stats->add(QBsdInputStats::Overflows);
+            deliver(m_events.first());
+            m_events.removeFirst();
+        }
+        m_events.append(event);
+    }
+
+    if (!m_retryTimer->isActive())
+        m_retryTimer->start();
+}
+
+bool QBsdEventQueue::coalesce(const Event &event)
+{
+    if (m_events.isEmpty())
+        return false;
+
+    Event &last = m_events.last();
+    if (last.type != event.type)
+        return false;
+
+    switch (event.type) {
+    case Event::Mouse:
+        // only motion merges, and only into motion: a queued press or
+        // release keeps the position it happened at
+        if (event.transition || last.transition)
+            return false;
+        last.pos = event.pos;
+        last.modifiers = event.modifiers;
+        return true;
+    case Event::Wheel:
+        last.pos = event.pos;
+        last.angleDelta += event.angleDelta;
+        last.modifiers = event.modifiers;
+        return true;
+    case Event::Key:
+        // another press of a key whose press is still queued is a repeat
+        // the application has not even seen the first of yet
+        return last.isPress && event.isPress && last.nativecode == event.nativecode;
+    case Event::Gesture:
+        // zoom steps add up like wheel deltas
+        if (event.gesture != Qt::ZoomNativeGesture || last.gesture != Qt::ZoomNativeGesture)
+            return false;
+        last.pos = event.pos;
+        last.value += event.value;
+        last.timestamp = event.timestamp;
+        return true;
+    case Event::Commit:
+        return false;
+    }
+
+    return false;
+}
+
+void QBsdEventQueue::flush()
+{
+    int delivered = 0;
+    while (delivered < m_events.size() && !isHeld())
+        deliver(m_events.at(delivered++));
+    m_events.remove(0, delivered);
+
+    if (!m_events.isEmpty())
+        m_retryTimer->start();
+}
+
+void QBsdEventQueue::sendKeyEvent(QWindow *window, const Event &event)
+{
+    QWindowSystemInterface::handleExtendedKeyEvent(window, event.isPress ? QEvent::KeyPress : QEvent::KeyRelease,
+                                                   event.qtcode, event.modifiers, event.nativecode, 0,
+                                                   int(event.modifiers), event.text, event.autoRepeat);
+}
+
+template <typename Functor>
+void QBsdEventQueue::sendFromGuiThread(Functor send)
+{
+    QSharedPointer<QAtomicInt> inFlight = m_guiSendsInFlight;
+    inFlight->ref();
+    QTimer::singleShot(0, qApp, [inFlight, send]() {
+        send();
+        inFlight->deref();
+    });
+}
+
+void QBsdEventQueue::deliver(const Event &event)
+{
+    if (m_stats)
+        m_stats->add(QBsdInputStats::Events);
+
+    switch (event.type) {
+    case Event::Mouse:
+        QWindowSystemInterface::handleMouseEvent(0, event.pos, event.pos, event.buttons, event.modifiers);
+        break;
+    case Event::Wheel:
+        QWindowSystemInterface::handleWheelEvent(0, event.pos, event.pos, QPoint(), event.angleDelta,
+                                                 event.modifiers);
+        break;
+    case Event::Key:
+        if (m_seat) {
+            // the seat's focus window belongs to the GUI thread
+            QBsdSeat *seat = m_seat;
+            const Event key = event;
+            sendFromGuiThread([seat, key]() { sendKeyEvent(seat->focusWindow(), key); });
+        } else {
+            sendKeyEvent(0, event);
+        }
+        break;
+    case Event::Commit: {
+        // the focus object belongs to the GUI thread
+        const QString text = event.text;
+        sendFromGuiThread([text]() {
+            // keys posted before the commit go first
+            QWindowSystemInterface::flushWindowSystemEvents();
+            if (QObject *focus = QGuiApplication::focusObject()) {
+                QInputMethodEvent event;
+                event.setCommitString(text);
+                QCoreApplication::sendEvent(focus, &event);
+            }
+        });
+        break;
+    }
+    case Event::Gesture: {
+#ifndef QT_NO_GESTURES
+        // native gestures are not routed to a window by position; find
+        // the one under the pointer where the windows live
+        const Event gesture = event;
+        sendFromGuiThread([gesture]() {
+            QWindow *window = QGuiApplication::topLevelAt(gesture.pos);
+            if (!window)
+                return;
+            QPointF local = window->mapFromGlobal(gesture.pos);
+            QPointF global = gesture.pos;
+            const Qt::NativeGestureType type = Qt::NativeGestureType(gesture.gesture);
+#if QT_VERSION >= QT_VERSION_CHECK(5, 10, 0)
+            // since 5.10 gestures name the device they come from, which
+            // goes away with its handler
+            if (!QTouchDevice::devices().contains(gesture.device))
+                return;
+            if (type == Qt::ZoomNativeGesture)
+                QWindowSystemInterface::handleGestureEventWithRealValue(window, gesture.device, gesture.timestamp,
+                                                                        type, gesture.value, local, global);
+            else
+                QWindowSystemInterface::handleGestureEvent(window, gesture.device, gesture.timestamp, type,
+                                                           local, global);
+#else
+            if (type == Qt::ZoomNativeGesture)
+                QWindowSystemInterface::handleGestureEventWithRealValue(window, gesture.timestamp, type,
+                                                                        gesture.value, local, global);
+            else
+                QWindowSystemInterface::handleGestureEvent(window, gesture.timestamp, type, local, global);
+#endif
+        });
+#endif
+        break;
+    }
+    }
+}
+
+QT_END_NAMESPACE
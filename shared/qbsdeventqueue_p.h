@@ -0,0 +1,167 @@
+/****************************************************************************
+**
+** Copyright (C) 2015-2016 Oleksandr Tymoshenko <gonzo@bluezbox.com>
+**
+** This file is part of the QtGui module of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:LGPL21$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see http://www.qt.io/terms-conditions. For further
+** information use the contact form at http://www.qt.io/contact-us.
+**
+** GNU Lesser General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU Lesser
+** General Public License version 2.1 or version 3 as published by the Free
+** Software Foundation and appearing in the file LICENSE.LGPLv21 and
+** LICENSE.LGPLv3 included in the packaging of this file. Please review the
+** following information to ensure the GNU Lesser General Public License
+** requirements will be met: https://www.gnu.org/licenses/lgpl.html and
+** http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+**
+** As a special exception, The Qt Company gives you certain additional
+** rights. These rights are described in The Qt Company LGPL Exception
+** version 1.1, included in the file LGPL_EXCEPTION.txt in this package.
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+#ifndef QBSDEVENTQUEUE_P_H
+#define QBSDEVENTQUEUE_P_H
+
+//
+//  W A R N I N G
+//  -------------
+//
+// This file is not part of the Qt API.  It exists purely as an
+// implementation detail.  This header file may change from version to
+// version without notice, or even be removed.
+//
+// We mean it.
+//
+
+#include <QAtomicInt>
+#include <QMutex>
+#include <QObject>
+#include <QPoint>
+#include <QSharedPointer>
+#include <QString>
+#include <QVector>
+
+QT_BEGIN_NAMESPACE
+
+class QTimer;
+class QTouchDevice;
+class QWindow;
+class QBsdSeat;
+struct QBsdInputStats;
+
+// Sits between a handler's decoder and QWindowSystemInterface. While the
+// GUI thread keeps up, events go straight through. Once it falls behind,
+// events are held here instead: consecutive motion is merged into the
+// latest position, wheel deltas are summed and a key repeat that is
+// still queued makes newer repeats of the same key redundant. Presses,
+// releases and button transitions are never dropped; when the queue is
+// full its oldest event is delivered regardless.
+//
+// Text commits have no window system event of their own and are sent
+// from the GUI thread once the window system events posted before them
+// are delivered. Gestures and the key events of a seat are sent from the
+// GUI thread too, which finds the window under the gesture or the seat's
+// focus window. Everything posted after any of them is held until it has
+// been sent.
+class QBsdEventQueue : public QObject
+{
+    Q_OBJECT
+public:
+    struct Event {
+        enum Type { Mouse, Wheel, Key, Commit, Gesture };
+
+        Type type;
+        QPoint pos;
+        QPoint angleDelta;
+        Qt::MouseButtons buttons;
+        Qt::KeyboardModifiers modifiers;
+        int qtcode;
+        int nativecode;
+        QString text;
+        bool isPress;
+        bool autoRepeat;
+        bool transition; // mouse event that changed the buttons
+        int gesture;     // Qt::NativeGestureType
+        qreal value;
+        QTouchDevice *device;
+        ulong timestamp;
+    };
+
+    explicit QBsdEventQueue(QObject *parent = 0);
+
+    // key events go to the seat's focus window, from the GUI thread
+    void setSeat(QBsdSeat *seat) { m_seat = seat; }
+
+    // counts delivered and coalesced events
+    void setStats(QBsdInputStats *stats) { m_stats = stats; }
+
+    void postMouseEvent(const QPoint &pos, Qt::MouseButtons buttons, Qt::KeyboardModifiers modifiers);
+    void postWheelEvent(const QPoint &pos, const QPoint &angleDelta, Qt::KeyboardModifiers modifiers);
+    void postKeyEvent(int nativecode, const QString &text, int qtcode, Qt::KeyboardModifiers modifiers,
+                      bool isPress, bool autoRepeat);
+
+    // a QInputMethodEvent committing text to the focus object
+    void postCommit(const QString &text);
+
+#ifndef QT_NO_GESTURES
+    // a native gesture for the top-level window at pos; device is only
+    // used from Qt 5.10
+    void postGestureEvent(const QPoint &pos, Qt::NativeGestureType type, qreal value, QTouchDevice *device,
+                          ulong timestamp);
+#endif
+
+    // Moves the platform cursor of the seat's screen, or of the primary
+    // screen, as soon as the GUI thread runs instead of when it gets to
+    // the mouse events still held or queued. Moves made before then merge.
+    void moveCursor(const QPoint &pos);
+
+    int size() const { return m_events.size(); }
+    quint64 coalesced() const { return m_coalesced; }
+
+protected:
+    // the GUI thread's state and the window system, replaced by the tests
+    virtual bool isBackedUp() const;
+    virtual void deliver(const Event &event);
+
+private slots:
+    void flush();
+
+private:
+    friend class tst_QBsdEventQueue;
+
+    void post(const Event &event);
+    bool coalesce(const Event &event);
+    bool isHeld() const { return isBackedUp() || m_guiSendsInFlight->load(); }
+    static void sendKeyEvent(QWindow *window, const Event &event);
+    template <typename Functor>
+    void sendFromGuiThread(Functor send);
+
+    QBsdSeat *m_seat;
+    QBsdInputStats *m_stats;
+    QVector<Event> m_events;
+    Qt::MouseButtons m_buttons;
+    QTimer *m_retryTimer;
+    quint64 m_coalesced;
+    QSharedPointer<QAtomicInt> m_guiSendsInFlight; // shared with the GUI thread's senders
+
+    struct CursorMove {
+        QMutex mutex;
+        QPoint pos;
+        bool pending;
+    };
+    QSharedPointer<CursorMove> m_cursorMove;
+};
+
+QT_END_NAMESPACE
+
+#endif // QBSDEVENTQUEUE_P_H
@@ -0,0 +1,211 @@
+/****************************************************************************
+**
+** Copyright (C) 2015-2016 Oleksandr Tymoshenko <gonzo@bluezbox.com>
+**
+** This file is part of the QtGui module of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:LGPL21$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see http://www.qt.io/terms-conditions. For further
+** information use the contact form at http://www.qt.io/contact-us.
+**
+** GNU Lesser General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU Lesser
+** General Public License version 2.1 or version 3 as published by the Free
+** Software Foundation and appearing in the file LICENSE.LGPLv21 and
+** LICENSE.LGPLv3 included in the packaging of this file. Please review the
+** following information to ensure the GNU Lesser General Public License
+** requirements will be met: https://www.gnu.org/licenses/lgpl.html and
+** http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+**
+** As a special exception, The Qt Company gives you certain additional
+** rights. These rights are described in The Qt Company LGPL Exception
+** version 1.1, included in the file LGPL_EXCEPTION.txt in this package.
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+#ifndef QBSDFLIGHTRECORDER_P_H
+#define QBSDFLIGHTRECORDER_P_H
+
+//
+//  W A R N I N G
+//  -------------
+//
+// This file is not part of the Qt API.  It exists purely as an
+// implementation detail.  This header file may change from version to
+// version without notice, or even be removed.
+//
+// We mean it.
+//
+
+#include <QAtomicInteger>
+
+#include <atomic>
+
+#include <errno.h>
+#include <signal.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+QT_BEGIN_NAMESPACE
+
+// Ring buffer of the most recent decoded input events of all handlers in
+// the process. Recording is a handful of plain stores and one atomic add,
+// and only happens when QT_BSD_INPUT_RECORDER is set. The buffer is then
+// written to stderr on SIGINFO (SIGURG where there is none), from the
+// signal handler itself so a hung GUI thread does not prevent the dump.
+struct QBsdFlightRecorder
+{
+    enum { Capacity = 256 };    // power of two
+
+    enum Type {
+        KeyDecode = 1,          // keycode, pressed, autorepeat
+        KeyEvent,               // Qt key, Qt modifiers, pressed
+        MousePacket,            // dx, dy, Qt buttons
+        MouseEvent              // x, y, Qt buttons
+    };
+
+    struct Entry {
+        QAtomicInteger<quint32> sequence;   // 0 while being written
+        int type;
+        qint64 time;                        // CLOCK_MONOTONIC, microseconds
+        int a, b, c;
+    };
+
+    QBsdFlightRecorder() : enabled(0), head(0) { }
+
+    QAtomicInt enabled;
+    QAtomicInteger<quint32> head;
+    Entry entries[Capacity];
+
+    void record(Type type, int a, int b, int c)
+    {
+        if (!enabled.load())
+            return;
+
+        const quint32 sequence = head.fetchAndAddRelaxed(1) + 1;
+        Entry &entry = entries[sequence % Capacity];
+
+        struct timespec ts;
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+
+        // the 0 must be visible before any of the new fields
+        entry.sequence.store(0);
+        std::atomic_thread_fence(std::memory_order_release);
+        entry.type = type;
+        entry.time = qint64(ts.tv_sec) * 1000000 + ts.tv_nsec / 1000;
+        entry.a = a;
+        entry.b = b;
+        entry.c = c;
+        entry.sequence.storeRelease(sequence);
+    }
+
+    // async-signal-safe: no allocation, no stdio
+    void dump(int fd) const
+    {
+        static const char *const names[] = { "?", "key-decode", "key-event", "mouse-packet", "mouse-event" };
+
+        const quint32 last = head.load();
+        const quint32 first = last > Capacity ? last - Capacity + 1 : 1;
+        for (quint32 sequence = first; sequence && sequence <= last; ++sequence) {
+            const Entry &slot = entries[sequence % Capacity];
+            // overwritten or still being written
+            if (slot.sequence.loadAcquire() != sequence)
+                continue;
+
+            // the writer may start over while we copy; keep the copy only
+            // if the sequence is still the same afterwards
+            struct {
+                int type;
+                qint64 time;
+                int a, b, c;
+            } entry = { slot.type, slot.time, slot.a, slot.b, slot.c };
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (slot.sequence.load() != sequence)
+                continue;
+
+            char line[128];
+            int length = 0;
+            length = appendNumber(line, length, entry.time);
+            line[length++] = ' ';
+            const char *name = names[(entry.type > 0 && entry.type <= MouseEvent) ? entry.type : 0];
+            while (*name)
+                line[length++] = *name++;
+            line[length++] = ' ';
+            length = appendNumber(line, length, entry.a);
+            line[length++] = ' ';
+            length = appendNumber(line, length, entry.b);
+            line[length++] = ' ';
+            length = appendNumber(line, length, entry.c);
+            line[length++] = '\n';
+            if (::write(fd, line, length) < 0)
+                return;
+        }
+    }
+
+    // Called once per process, when the shared input state is created.
+    void setup()
+    {
+        if (!qEnvironmentVariableIsSet("QT_BSD_INPUT_RECORDER"))
+            return;
+
+        instance() = this;
+        enabled.store(1);
+
+        struct sigaction sa;
+        memset(&sa, 0, sizeof(sa));
+        sa.sa_handler = dumpOnSignal;
+        sa.sa_flags = SA_RESTART;
+        sigemptyset(&sa.sa_mask);
+#ifdef SIGINFO
+        sigaction(SIGINFO, &sa, 0);
+#else
+        sigaction(SIGURG, &sa, 0);
+#endif
+    }
+
+private:
+    static QBsdFlightRecorder *&instance()
+    {
+        static QBsdFlightRecorder *s_recorder = 0;
+        return s_recorder;
+    }
+
+    static void dumpOnSignal(int)
+    {
+        const int savedErrno = errno;
+        if (instance())
+            instance()->dump(STDERR_FILENO);
+        errno = savedErrno;
+    }
+
+    static int appendNumber(char *buffer, int length, qint64 value)
+    {
+        char digits[24];
+        int count = 0;
+        const bool negative = value < 0;
+        quint64 magnitude = negative ? quint64(-(value + 1)) + 1 : quint64(value);
+        do {
+            digits[count++] = char('0' + magnitude % 10);
+            magnitude /= 10;
+        } while (magnitude);
+
+        if (negative)
+            buffer[length++] = '-';
+        while (count)
+            buffer[length++] = digits[--count];
+        return length;
+    }
+
+    Q_DISABLE_COPY(QBsdFlightRecorder)
+};
+
+QT_END_NAMESPACE
+
+#endif // QBSDFLIGHTRECORDER_P_H
@@ -0,0 +1,111 @@
+/****************************************************************************
+**
+** Copyright (C) 2015-2016 Oleksandr Tymoshenko <gonzo@bluezbox.com>
+**
+** This file is part of the QtGui module of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:LGPL21$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see http://www.qt.io/terms-conditions. For further
+** information use the contact form at http://www.qt.io/contact-us.
+**
+** GNU Lesser General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU Lesser
+** General Public License version 2.1 or version 3 as published by the Free
+** Software Foundation and appearing in the file LICENSE.LGPLv21 and
+** LICENSE.LGPLv3 included in the packaging of this file. Please review the
+** following information to ensure the GNU Lesser General Public License
+** requirements will be met: https://www.gnu.org/licenses/lgpl.html and
+** http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+**
+** As a special exception, The Qt Company gives you certain additional
+** rights. These rights are described in The Qt Company LGPL Exception
+** version 1.1, included in the file LGPL_EXCEPTION.txt in this package.
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+#include "qbsdinjectionserver_p.h"
+
+#include <QFile>
+#include <QSocketNotifier>
+#include <private/qcore_unix_p.h>
+
+#include <errno.h>
+
+QT_BEGIN_NAMESPACE
+
+enum {
+    MaxReadsPerActivation = 16 // the notifier fires again for the rest
+};
+
+QBsdInjectionServer::QBsdInjectionServer(const QString &path, QObject *parent) :
+    QObject(parent),
+    m_listenNotifier(0)
+{
+    // only the owner may inject input
+    if (!m_socket.listen(QFile::encodeName(path), "injection"))
+        return;
+
+    m_listenNotifier = new QSocketNotifier(m_socket.socketDescriptor(), QSocketNotifier::Read, this);
+    connect(m_listenNotifier, SIGNAL(activated(int)), this, SLOT(acceptConnection()));
+}
+
+QBsdInjectionServer::~QBsdInjectionServer()
+{
+    const QList<int> clients = m_clients.keys();
+    for (int fd : clients)
+        closeClient(fd);
+
+    delete m_listenNotifier;
+}
+
+void QBsdInjectionServer::acceptConnection()
+{
+    forever {
+        const int fd = m_socket.accept();
+        if (fd < 0)
+            return;
+
+        QSocketNotifier *notifier = new QSocketNotifier(fd, QSocketNotifier::Read, this);
+        connect(notifier, SIGNAL(activated(int)), this, SLOT(readClient(int)));
+        m_clients.insert(fd, notifier);
+    }
+}
+
+void QBsdInjectionServer::readClient(int fd)
+{
+    char buffer[4096];
+
+    // bounded, so a client writing flat out cannot starve the event loop
+    for (int reads = 0; reads < MaxReadsPerActivation; ++reads) {
+        const ssize_t size = QT_READ(fd, buffer, sizeof(buffer));
+        if (size < 0 && errno == EAGAIN)
+            return;
+        if (size <= 0) {
+            closeClient(fd);
+            emit clientClosed(fd);
+            return;
+        }
+
+        emit received(fd, QByteArray(buffer, int(size)));
+    }
+}
+
+void QBsdInjectionServer::closeClient(int fd)
+{
+    QSocketNotifier *notifier = m_clients.take(fd);
+    if (!notifier)
+        return;
+
+    // may be called from the notifier's own activation
+    notifier->setEnabled(false);
+    notifier->deleteLater();
+    qt_safe_close(fd);
+}
+
+QT_END_NAMESPACE
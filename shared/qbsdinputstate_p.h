@@ -0,0 +1,166 @@
+/****************************************************************************
+**
+** Copyright (C) 2015-2016 Oleksandr Tymoshenko <gonzo@bluezbox.com>
+**
+** This file is part of the QtGui module of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:LGPL21$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see http://www.qt.io/terms-conditions. For further
+** information use the contact form at http://www.qt.io/contact-us.
+**
+** GNU Lesser General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU Lesser
+** General Public License version 2.1 or version 3 as published by the Free
+** Software Foundation and appearing in the file LICENSE.LGPLv21 and
+** LICENSE.LGPLv3 included in the packaging of this file. Please review the
+** following information to ensure the GNU Lesser General Public License
+** requirements will be met: https://www.gnu.org/licenses/lgpl.html and
+** http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+**
+** As a special exception, The Qt Company gives you certain additional
+** rights. These rights are described in The Qt Company LGPL Exception
+** version 1.1, included in the file LGPL_EXCEPTION.txt in this package.
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+#ifndef QBSDINPUTSTATE_P_H
+#define QBSDINPUTSTATE_P_H
+
+//
+//  W A R N I N G
+//  -------------
+//
+// This file is not part of the Qt API.  It exists purely as an
+// implementation detail.  This header file may change from version to
+// version without notice, or even be removed.
+//
+// We mean it.
+//
+
+#include <QAtomicInt>
+#include <QCoreApplication>
+#include <QHash>
+#include <QVariant>
+#include <QVector>
+
+#include "qbsdflightrecorder_p.h"
+#include "qbsdinputstats_p.h"
+#include "qbsdmetricsexporter_p.h"
+#include "qbsdseat_p.h"
+#include "qbsdsharedinput_p.h"
+
+QT_BEGIN_NAMESPACE
+
+// Input state shared by the keyboard and mouse plugins of one process. Each
+// plugin is built separately, so the single instance is found through a
+// dynamic property on the application object rather than a common symbol.
+// All fields are written by one handler and read by the others without locks.
+struct QBsdInputState
+{
+    QBsdInputState() : keyboardModifiers(0), metricsExporter(0) { }
+
+    // Qt::KeyboardModifiers currently held, published by the keyboard handler
+    QAtomicInt keyboardModifiers;
+
+    // recent events of all handlers, for post-mortem dumps
+    QBsdFlightRecorder recorder;
+
+    // pointer and keyboard state for other processes
+    QBsdSharedInput shared;
+
+    // Seats named by the handlers' specs; like the instance, they are
+    // looked up and created from the GUI thread and never go away.
+    QBsdSeat *seat(const QString &name)
+    {
+        QBsdSeat *&seat = seats[name];
+        if (!seat)
+            seat = new QBsdSeat(name);
+        return seat;
+    }
+
+    QHash<QString, QBsdSeat *> seats;
+
+    // Counters for one device, kept for the life of the process; also
+    // created from the GUI thread. The first one starts the exporter.
+    QBsdInputStats *registerStats(const char *handler, const QByteArray &device)
+    {
+        QBsdInputStats *s = new QBsdInputStats(handler, device);
+        stats.append(s);
+
+        const QByteArray target = qgetenv("QT_BSD_INPUT_METRICS");
+        if (!metricsExporter && !target.isEmpty())
+            metricsExporter = new QBsdMetricsExporter(target, &stats, QCoreApplication::instance());
+        return s;
+    }
+
+    QVector<QBsdInputStats *> stats;
+    QBsdMetricsExporter *metricsExporter;
+
+    // Keyboard handlers, published to applications as the property
+    // "bsdKeyboardHandlers" of the application object: a QVariantList of
+    // QObject pointers, in the order of the -plugin arguments. Updated from
+    // the GUI thread as handlers come and go.
+    void addKeyboardHandler(QObject *handler)
+    {
+        keyboardHandlers.append(handler);
+        publishKeyboardHandlers();
+    }
+
+    void removeKeyboardHandler(QObject *handler)
+    {
+        keyboardHandlers.removeAll(handler);
+        publishKeyboardHandlers();
+    }
+
+    QVector<QObject *> keyboardHandlers;
+
+    // Plugins are created from the GUI thread, so lookup and creation do not
+    // race. The instance lives as long as the process.
+    static QBsdInputState *instance()
+    {
+        static QBsdInputState *s_instance = 0;
+        if (s_instance)
+            return s_instance;
+
+        static const char propertyName[] = "_q_bsdInputState";
+        QCoreApplication *app = QCoreApplication::instance();
+        const QVariant v = app ? app->property(propertyName) : QVariant();
+
+        if (v.isValid()) {
+            s_instance = reinterpret_cast<QBsdInputState *>(v.value<quintptr>());
+        } else {
+            s_instance = new QBsdInputState;
+            s_instance->recorder.setup();
+            s_instance->shared.setup();
+            if (app)
+                app->setProperty(propertyName, QVariant::fromValue(quintptr(s_instance)));
+        }
+
+        return s_instance;
+    }
+
+private:
+    void publishKeyboardHandlers()
+    {
+        QCoreApplication *app = QCoreApplication::instance();
+        if (!app)
+            return;
+        QVariantList handlers;
+        for (QObject *handler : qAsConst(keyboardHandlers))
+            handlers.append(QVariant::fromValue(handler));
+        app->setProperty("bsdKeyboardHandlers", handlers);
+    }
+
+    Q_DISABLE_COPY(QBsdInputState)
+};
+
+QT_END_NAMESPACE
+
+#endif // QBSDINPUTSTATE_P_H
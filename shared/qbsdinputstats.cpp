@@ -0,0 +1,90 @@
+/****************************************************************************
+**
+** Copyright (C) 2015-2016 Oleksandr Tymoshenko <gonzo@bluezbox.com>
+**
+** This file is part of the QtGui module of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:LGPL21$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see http://www.qt.io/terms-conditions. For further
+** information use the contact form at http://www.qt.io/contact-us.
+**
+** GNU Lesser General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU Lesser
+** General Public License version 2.1 or version 3 as published by the Free
+** Software Foundation and appearing in the file LICENSE.LGPLv21 and
+** LICENSE.LGPLv3 included in the packaging of this file. Please review the
+** following information to ensure the GNU Lesser General Public License
+** requirements will be met: https://www.gnu.org/licenses/lgpl.html and
+** http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+**
+** As a special exception, The Qt Company gives you certain additional
+** rights. These rights are described in The Qt Company LGPL Exception
+** version 1.1, included in the file LGPL_EXCEPTION.txt in this package.
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+#include "qbsdinputstats_p.h"
+
+QT_BEGIN_NAMESPACE
+
+static const struct {
+    const char *name;
+    const char *help;
+} counterInfo[QBsdInputStats::CounterCount] = {
+    { "qt_bsd_input_reads_total", "read(2) calls on the device." },
+    { "qt_bsd_input_bytes_total", "Bytes read from the device." },
+    { "qt_bsd_input_packets_total", "Keycodes or mouse packets decoded." },
+    { "qt_bsd_input_events_total", "Window system events posted." },
+    { "qt_bsd_input_framing_errors_total", "Times the mouse packet stream lost sync." },
+    { "qt_bsd_input_keymap_misses_total", "Keycodes without a keymap entry." },
+    { "qt_bsd_input_led_ioctls_total", "Keyboard LED queries and updates." },
+    { "qt_bsd_input_coalesced_events_total", "Events merged while the GUI thread lagged behind." },
+    { "qt_bsd_input_dropped_events_total", "Key repeats dropped while the GUI thread lagged behind." },
+    { "qt_bsd_input_queue_overflows_total", "Events delivered early because the event queue was full." },
+    { "qt_bsd_input_injected_bytes_total", "Bytes received on the injection socket." },
+    { "qt_bsd_input_injected_batches_total", "Writes received on the injection socket." }
+};
+
+static QByteArray labelValue(const QByteArray &value)
+{
+    QByteArray escaped = value;
+    escaped.replace('\\', "\\\\");
+    escaped.replace('"', "\\\"");
+    escaped.replace('\n', "\\n");
+    return escaped;
+}
+
+QByteArray QBsdInputStats::format(const QVector<QBsdInputStats *> &stats)
+{
+    QByteArray text;
+    for (int counter = 0; counter < CounterCount; ++counter) {
+        text += "# HELP ";
+        text += counterInfo[counter].name;
+        text += ' ';
+        text += counterInfo[counter].help;
+        text += "\n# TYPE ";
+        text += counterInfo[counter].name;
+        text += " counter\n";
+
+        for (const QBsdInputStats *s : stats) {
+            text += counterInfo[counter].name;
+            text += "{handler=\"";
+            text += s->handler;
+            text += "\",device=\"";
+            text += labelValue(s->device);
+            text += "\"} ";
+            text += QByteArray::number(s->value(Counter(counter)));
+            text += '\n';
+        }
+    }
+    return text;
+}
+
+QT_END_NAMESPACE
@@ -0,0 +1,93 @@
+/****************************************************************************
+**
+** Copyright (C) 2015-2016 Oleksandr Tymoshenko <gonzo@bluezbox.com>
+**
+** This file is part of the QtGui module of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:LGPL21$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see http://www.qt.io/terms-conditions. For further
+** information use the contact form at http://www.qt.io/contact-us.
+**
+** GNU Lesser General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU Lesser
+** General Public License version 2.1 or version 3 as published by the Free
+** Software Foundation and appearing in the file LICENSE.LGPLv21 and
+** LICENSE.LGPLv3 included in the packaging of this file. Please review the
+** following information to ensure the GNU Lesser General Public License
+** requirements will be met: https://www.gnu.org/licenses/lgpl.html and
+** http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+**
+** As a special exception, The Qt Company gives you certain additional
+** rights. These rights are described in The Qt Company LGPL Exception
+** version 1.1, included in the file LGPL_EXCEPTION.txt in this package.
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+#ifndef QBSDINPUTSTATS_P_H
+#define QBSDINPUTSTATS_P_H
+
+//
+//  W A R N I N G
+//  -------------
+//
+// This file is not part of the Qt API.  It exists purely as an
+// implementation detail.  This header file may change from version to
+// version without notice, or even be removed.
+//
+// We mean it.
+//
+
+#include <QAtomicInteger>
+#include <QByteArray>
+#include <QVector>
+
+QT_BEGIN_NAMESPACE
+
+// Counters of one input device. They are bumped with relaxed atomic adds
+// from whichever thread reads the device and read by the metrics exporter
+// in the GUI thread; the values are only meant to be eventually accurate.
+struct QBsdInputStats
+{
+    enum Counter {
+        Reads,              // read(2) calls
+        Bytes,              // bytes read from the device
+        Packets,            // keycodes or mouse packets decoded
+        Events,             // window system events posted
+        FramingErrors,      // mouse packet sync lost
+        KeymapMisses,       // keycodes without a mapping
+        LedIoctls,          // LED queries and updates
+        Coalesced,          // events merged while the GUI thread lagged
+        Dropped,            // key repeats dropped while the GUI thread lagged
+        Overflows,          // events let through early because the queue was full
+        InjectedBytes,      // bytes received on the injection socket
+        InjectedBatches,    // writes received on the injection socket
+        CounterCount
+    };
+
+    QBsdInputStats(const char *handler, const QByteArray &device) :
+        handler(handler), device(device) { }
+
+    void add(Counter counter, quint64 n = 1) { counters[counter].fetchAndAddRelaxed(n); }
+    quint64 value(Counter counter) const { return counters[counter].load(); }
+
+    // Prometheus text exposition format
+    static QByteArray format(const QVector<QBsdInputStats *> &stats);
+
+    const char *const handler;
+    const QByteArray device;
+    QAtomicInteger<quint64> counters[CounterCount];
+
+private:
+    Q_DISABLE_COPY(QBsdInputStats)
+};
+
+QT_END_NAMESPACE
+
+#endif // QBSDINPUTSTATS_P_H
@@ -0,0 +1,90 @@
+/****************************************************************************
+**
+** Copyright (C) 2015-2016 Oleksandr Tymoshenko <gonzo@bluezbox.com>
+**
+** This file is part of the QtGui module of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:LGPL21$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see http://www.qt.io/terms-conditions. For further
+** information use the contact form at http://www.qt.io/contact-us.
+**
+** GNU Lesser General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU Lesser
+** General Public License version 2.1 or version 3 as published by the Free
+** Software Foundation and appearing in the file LICENSE.LGPLv21 and
+** LICENSE.LGPLv3 included in the packaging of this file. Please review the
+** following information to ensure the GNU Lesser General Public License
+** requirements will be met: https://www.gnu.org/licenses/lgpl.html and
+** http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+**
+** As a special exception, The Qt Company gives you certain additional
+** rights. These rights are described in The Qt Company LGPL Exception
+** version 1.1, included in the file LGPL_EXCEPTION.txt in this package.
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+#ifndef QBSDINPUTTRACE_P_H
+#define QBSDINPUTTRACE_P_H
+
+//
+//  W A R N I N G
+//  -------------
+//
+// This file is not part of the Qt API.  It exists purely as an
+// implementation detail.  This header file may change from version to
+// version without notice, or even be removed.
+//
+// We mean it.
+//
+
+#include <QtGlobal>
+
+// Statically defined tracepoints, declared in qbsdinput.d. Built with
+// CONFIG+=usdt they become DTrace probes on FreeBSD (from a header
+// generated by dtrace -h) and systemtap-style SDT notes elsewhere, usable
+// from bpftrace. A disabled probe costs a nop; without usdt the macros
+// expand to nothing at all.
+
+#if defined(QT_BSD_INPUT_USDT) && defined(Q_OS_FREEBSD)
+
+#include "qbsdinput_provider.h"
+
+#define QBSD_TRACE_READ(fd, bytes)                  QBSDINPUT_READ(fd, bytes)
+#define QBSD_TRACE_KEY_DECODE(code, down, repeat)   QBSDINPUT_KEY_DECODE(code, down, repeat)
+#define QBSD_TRACE_KEYMAP_LOOKUP(code, mods, key)   QBSDINPUT_KEYMAP_LOOKUP(code, mods, key)
+#define QBSD_TRACE_LED(led, state)                  QBSDINPUT_LED(led, state)
+#define QBSD_TRACE_KEY_EVENT(key, mods, down)       QBSDINPUT_KEY_EVENT(key, mods, down)
+#define QBSD_TRACE_MOUSE_PACKET(dx, dy, buttons)    QBSDINPUT_MOUSE_PACKET(dx, dy, buttons)
+#define QBSD_TRACE_MOUSE_EVENT(x, y, buttons)       QBSDINPUT_MOUSE_EVENT(x, y, buttons)
+
+#elif defined(QT_BSD_INPUT_USDT)
+
+#include <sys/sdt.h>
+
+#define QBSD_TRACE_READ(fd, bytes)                  DTRACE_PROBE2(qbsdinput, read, fd, bytes)
+#define QBSD_TRACE_KEY_DECODE(code, down, repeat)   DTRACE_PROBE3(qbsdinput, key__decode, code, down, repeat)
+#define QBSD_TRACE_KEYMAP_LOOKUP(code, mods, key)   DTRACE_PROBE3(qbsdinput, keymap__lookup, code, mods, key)
+#define QBSD_TRACE_LED(led, state)                  DTRACE_PROBE2(qbsdinput, led, led, state)
+#define QBSD_TRACE_KEY_EVENT(key, mods, down)       DTRACE_PROBE3(qbsdinput, key__event, key, mods, down)
+#define QBSD_TRACE_MOUSE_PACKET(dx, dy, buttons)    DTRACE_PROBE3(qbsdinput, mouse__packet, dx, dy, buttons)
+#define QBSD_TRACE_MOUSE_EVENT(x, y, buttons)       DTRACE_PROBE3(qbsdinput, mouse__event, x, y, buttons)
+
+#else
+
+#define QBSD_TRACE_READ(fd, bytes)                  do { } while (0)
+#define QBSD_TRACE_KEY_DECODE(code, down, repeat)   do { } while (0)
+#define QBSD_TRACE_KEYMAP_LOOKUP(code, mods, key)   do { } while (0)
+#define QBSD_TRACE_LED(led, state)                  do { } while (0)
+#define QBSD_TRACE_KEY_EVENT(key, mods, down)       do { } while (0)
+#define QBSD_TRACE_MOUSE_PACKET(dx, dy, buttons)    do { } while (0)
+#define QBSD_TRACE_MOUSE_EVENT(x, y, buttons)       do { } while (0)
+
+#endif
+
+#endif // QBSDINPUTTRACE_P_H
@@ -0,0 +1,111 @@
+/****************************************************************************
+**
+** Copyright (C) 2015-2016 Oleksandr Tymoshenko <gonzo@bluezbox.com>
+**
+** This file is part of the QtGui module of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:LGPL21$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see http://www.qt.io/terms-conditions. For further
+** information use the contact form at http://www.qt.io/contact-us.
+**
+** GNU Lesser General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU Lesser
+** General Public License version 2.1 or version 3 as published by the Free
+** Software Foundation and appearing in the file LICENSE.LGPLv21 and
+** LICENSE.LGPLv3 included in the packaging of this file. Please review the
+** following information to ensure the GNU Lesser General Public License
+** requirements will be met: https://www.gnu.org/licenses/lgpl.html and
+** http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+**
+** As a special exception, The Qt Company gives you certain additional
+** rights. These rights are described in The Qt Company LGPL Exception
+** version 1.1, included in the file LGPL_EXCEPTION.txt in this package.
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+#include "qbsdmetricsexporter_p.h"
+#include "qbsdinputstats_p.h"
+
+#include <QFile>
+#include <QSaveFile>
+#include <QSocketNotifier>
+#include <QTimer>
+#include <private/qcore_unix_p.h>
+
+QT_BEGIN_NAMESPACE
+
+enum {
+    DefaultInterval = 10,   // s
+    MaxAcceptsPerActivation = 16
+};
+
+QBsdMetricsExporter::QBsdMetricsExporter(const QByteArray &target, const QVector<QBsdInputStats *> *stats,
+                                         QObject *parent) :
+    QObject(parent),
+    m_stats(stats),
+    m_listenNotifier(0),
+    m_timer(0)
+{
+    if (target.startsWith("unix:")) {
+        // the counters tell how fast someone types, only the owner may scrape
+        if (m_socket.listen(target.mid(5), "metrics")) {
+            m_listenNotifier = new QSocketNotifier(m_socket.socketDescriptor(), QSocketNotifier::Read, this);
+            connect(m_listenNotifier, SIGNAL(activated(int)), this, SLOT(acceptConnection()));
+        }
+        return;
+    }
+
+    m_path = target;
+    bool ok;
+    int interval = qEnvironmentVariableIntValue("QT_BSD_INPUT_METRICS_INTERVAL", &ok);
+    if (!ok || interval <= 0)
+        interval = DefaultInterval;
+
+    m_timer = new QTimer(this);
+    m_timer->setInterval(interval * 1000);
+    connect(m_timer, SIGNAL(timeout()), this, SLOT(writeFile()));
+    m_timer->start();
+}
+
+QBsdMetricsExporter::~QBsdMetricsExporter()
+{
+    delete m_listenNotifier;
+}
+
+void QBsdMetricsExporter::acceptConnection()
+{
+    // bounded, so a client connecting flat out cannot starve the event loop
+    for (int accepts = 0; accepts < MaxAcceptsPerActivation; ++accepts) {
+        const int fd = m_socket.accept();
+        if (fd < 0)
+            return;
+
+        // a few kilobytes fit into the socket buffer, the scraper reads
+        // them after we have hung up; never block the GUI thread on it
+        const QByteArray text = QBsdInputStats::format(*m_stats);
+        qt_safe_write(fd, text.constData(), text.size());
+        qt_safe_close(fd);
+    }
+}
+
+void QBsdMetricsExporter::writeFile()
+{
+    // readers never see a partially written file
+    QSaveFile file(QFile::decodeName(m_path));
+    if (!file.open(QIODevice::WriteOnly)) {
+        qWarning("Cannot write metrics to %s: %s", m_path.constData(), qPrintable(file.errorString()));
+        m_timer->stop();
+        return;
+    }
+    file.write(QBsdInputStats::format(*m_stats));
+    file.commit();
+}
+
+QT_END_NAMESPACE
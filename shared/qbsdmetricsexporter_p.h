@@ -0,0 +1,86 @@
+/****************************************************************************
+**
+** Copyright (C) 2015-2016 Oleksandr Tymoshenko <gonzo@bluezbox.com>
+**
+** This file is part of the QtGui module of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:LGPL21$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see http://www.qt.io/terms-conditions. For further
+** information use the contact form at http://www.qt.io/contact-us.
+**
+** GNU Lesser General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU Lesser
+** General Public License version 2.1 or version 3 as published by the Free
+** Software Foundation and appearing in the file LICENSE.LGPLv21 and
+** LICENSE.LGPLv3 included in the packaging of this file. Please review the
+** following information to ensure the GNU Lesser General Public License
+** requirements will be met: https://www.gnu.org/licenses/lgpl.html and
+** http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+**
+** As a special exception, The Qt Company gives you certain additional
+** rights. These rights are described in The Qt Company LGPL Exception
+** version 1.1, included in the file LGPL_EXCEPTION.txt in this package.
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+#ifndef QBSDMETRICSEXPORTER_P_H
+#define QBSDMETRICSEXPORTER_P_H
+
+//
+//  W A R N I N G
+//  -------------
+//
+// This file is not part of the Qt API.  It exists purely as an
+// implementation detail.  This header file may change from version to
+// version without notice, or even be removed.
+//
+// We mean it.
+//
+
+#include <QByteArray>
+#include <QObject>
+#include <QVector>
+
+#include "qbsdunixserversocket_p.h"
+
+QT_BEGIN_NAMESPACE
+
+class QSocketNotifier;
+class QTimer;
+struct QBsdInputStats;
+
+// Publishes the counters of all input devices in the Prometheus text
+// format. QT_BSD_INPUT_METRICS selects where to:
+//   unix:<path>  a stream socket, every connection gets one snapshot
+//   <path>       a file, atomically rewritten every
+//                QT_BSD_INPUT_METRICS_INTERVAL seconds (default 10)
+class QBsdMetricsExporter : public QObject
+{
+    Q_OBJECT
+public:
+    QBsdMetricsExporter(const QByteArray &target, const QVector<QBsdInputStats *> *stats,
+                        QObject *parent = 0);
+    ~QBsdMetricsExporter() override;
+
+private slots:
+    void writeFile();
+    void acceptConnection();
+
+private:
+    const QVector<QBsdInputStats *> *m_stats;
+    QByteArray m_path;
+    QBsdUnixServerSocket m_socket;
+    QSocketNotifier *m_listenNotifier;
+    QTimer *m_timer;
+};
+
+QT_END_NAMESPACE
+
+#endif // QBSDMETRICSEXPORTER_P_H
@@ -0,0 +1,148 @@
+/****************************************************************************
+**
+** Copyright (C) 2015-2016 Oleksandr Tymoshenko <gonzo@bluezbox.com>
+**
+** This file is part of the QtGui module of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:LGPL21$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see http://www.qt.io/terms-conditions. For further
+** information use the contact form at http://www.qt.io/contact-us.
+**
+** GNU Lesser General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU Lesser
+** General Public License version 2.1 or version 3 as published by the Free
+** Software Foundation and appearing in the file LICENSE.LGPLv21 and
+** LICENSE.LGPLv3 included in the packaging of this file. Please review the
+** following information to ensure the GNU Lesser General Public License
+** requirements will be met: https://www.gnu.org/licenses/lgpl.html and
+** http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+**
+** As a special exception, The Qt Company gives you certain additional
+** rights. These rights are described in The Qt Company LGPL Exception
+** version 1.1, included in the file LGPL_EXCEPTION.txt in this package.
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+#include "qbsdseat_p.h"
+#include "qbsdinputlogging_p.h"
+
+#include <QGuiApplication>
+#include <QMutexLocker>
+#include <QScreen>
+#include <QTimer>
+#include <QWindow>
+
+QT_BEGIN_NAMESPACE
+
+QBsdSeat::QBsdSeat(const QString &name) :
+    keyboardModifiers(0),
+    m_name(name)
+{
+    QObject::connect(qApp, &QGuiApplication::focusWindowChanged, qApp,
+                     [this](QWindow *window) { windowActivated(window); });
+
+    QObject::connect(qApp, &QGuiApplication::screenAdded, qApp, [this]() { updateScreen(); });
+    QObject::connect(qApp, &QGuiApplication::screenRemoved, qApp, [this]() { updateScreen(); });
+    QObject::connect(qApp, &QGuiApplication::primaryScreenChanged, qApp, [this]() { updateScreen(); });
+    updateScreen();
+}
+
+bool QBsdSeat::bindScreen(const QString &screen)
+{
+    if (screen.isEmpty() || screen == m_screen)
+        return true;
+    if (!m_screen.isEmpty())
+        return false;
+    m_screen = screen;
+    updateScreen();
+    return true;
+}
+
+void QBsdSeat::updateScreen()
+{
+    QScreen *found = 0;
+    if (!m_screen.isEmpty()) {
+        const QList<QScreen *> screens = QGuiApplication::screens();
+        bool isIndex;
+        const int index = m_screen.toInt(&isIndex);
+        if (isIndex) {
+            if (index >= 0 && index < screens.size())
+                found = screens.at(index);
+        } else {
+            for (QScreen *screen : screens) {
+                if (screen->name() == m_screen) {
+                    found = screen;
+                    break;
+                }
+            }
+        }
+    }
+    if (!found)
+        found = QGuiApplication::primaryScreen();
+
+    QObject::disconnect(m_geometryConnection);
+    QObject::disconnect(m_virtualGeometryConnection);
+    if (found) {
+        m_geometryConnection = QObject::connect(found, &QScreen::geometryChanged, qApp,
+                                                [this]() { updateGeometry(); });
+        m_virtualGeometryConnection = QObject::connect(found, &QScreen::virtualGeometryChanged, qApp,
+                                                       [this]() { updateGeometry(); });
+    }
+    m_screenCache.storeRelease(found);
+    updateGeometry();
+}
+
+void QBsdSeat::updateGeometry()
+{
+    QScreen *screen = QBsdSeat::screen();
+    const QRect geometry = !screen ? QRect()
+                                   : m_screen.isEmpty() ? screen->virtualGeometry() : screen->geometry();
+
+    QMutexLocker locker(&m_geometryMutex);
+    m_geometry = geometry;
+}
+
+QRect QBsdSeat::geometry() const
+{
+    QMutexLocker locker(&m_geometryMutex);
+    return m_geometry;
+}
+
+void QBsdSeat::pointerPressed(const QPoint &globalPos)
+{
+    if (m_screen.isEmpty())
+        return;
+
+    // window lookup belongs to the GUI thread
+    QTimer::singleShot(0, qApp, [this, globalPos]() {
+        QWindow *window = QGuiApplication::topLevelAt(globalPos);
+        if (window && window->screen() == screen())
+            setFocusWindow(window);
+    });
+}
+
+void QBsdSeat::windowActivated(QWindow *window)
+{
+    if (window && !m_screen.isEmpty() && window->screen() == screen())
+        setFocusWindow(window);
+    else if (!m_focus)
+        emit focusWindowChanged(); // keys still go to the application's
+}
+
+void QBsdSeat::setFocusWindow(QWindow *window)
+{
+    if (m_focus == window)
+        return;
+    qCDebug(qLcBsdKeyboard) << "Seat" << m_name << "focus" << window;
+    m_focus = window;
+    emit focusWindowChanged();
+}
+
+QT_END_NAMESPACE
@@ -0,0 +1,123 @@
+/****************************************************************************
+**
+** Copyright (C) 2015-2016 Oleksandr Tymoshenko <gonzo@bluezbox.com>
+**
+** This file is part of the QtGui module of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:LGPL21$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see http://www.qt.io/terms-conditions. For further
+** information use the contact form at http://www.qt.io/contact-us.
+**
+** GNU Lesser General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU Lesser
+** General Public License version 2.1 or version 3 as published by the Free
+** Software Foundation and appearing in the file LICENSE.LGPLv21 and
+** LICENSE.LGPLv3 included in the packaging of this file. Please review the
+** following information to ensure the GNU Lesser General Public License
+** requirements will be met: https://www.gnu.org/licenses/lgpl.html and
+** http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+**
+** As a special exception, The Qt Company gives you certain additional
+** rights. These rights are described in The Qt Company LGPL Exception
+** version 1.1, included in the file LGPL_EXCEPTION.txt in this package.
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+#ifndef QBSDSEAT_P_H
+#define QBSDSEAT_P_H
+
+//
+//  W A R N I N G
+//  -------------
+//
+// This file is not part of the Qt API.  It exists purely as an
+// implementation detail.  This header file may change from version to
+// version without notice, or even be removed.
+//
+// We mean it.
+//
+
+#include <QAtomicInt>
+#include <QAtomicPointer>
+#include <QMetaObject>
+#include <QMutex>
+#include <QObject>
+#include <QPoint>
+#include <QPointer>
+#include <QRect>
+#include <QString>
+
+QT_BEGIN_NAMESPACE
+
+class QScreen;
+class QWindow;
+
+// A group of input devices serving one operator station, selected with
+// the spec options "seat=<name>" and "screen=<name|index>". A seat bound
+// to a screen keeps its pointer on that screen and sends its key events
+// to its own focus window: the last top-level window on the screen that
+// was activated or clicked by the seat's pointer. Until there is one,
+// keys go to the application's focus window as without seats.
+//
+// Seats are shared by the plugins through QBsdInputState. They are created
+// and bound from the GUI thread, and their focus window is only looked at
+// there; everything else may be called from the handlers' reader threads.
+// The screen and its geometry are looked up in the GUI thread whenever the
+// screens change and cached for the readers.
+//
+// Seats only route events. Qt 5 keeps a single mouse button state for the
+// whole process, so buttons held at the same time on the pointers of two
+// seats still look like one pointer's buttons to the application.
+class QBsdSeat : public QObject
+{
+    Q_OBJECT
+public:
+    explicit QBsdSeat(const QString &name);
+
+    QString name() const { return m_name; }
+
+    // the first binding wins, returns false on a conflicting one
+    bool bindScreen(const QString &screen);
+
+    QScreen *screen() const { return m_screenCache.loadAcquire(); }
+    QRect geometry() const;
+
+    // GUI thread only; 0 while keys go to the application's focus window
+    QWindow *focusWindow() const { return m_focus.data(); }
+    void pointerPressed(const QPoint &globalPos);
+
+    // Qt::KeyboardModifiers held on the seat's keyboards
+    QAtomicInt keyboardModifiers;
+
+signals:
+    // the window that gets the seat's keys may have changed
+    void focusWindowChanged();
+
+private:
+    void updateScreen();
+    void updateGeometry();
+    void windowActivated(QWindow *window);
+    void setFocusWindow(QWindow *window);
+
+    const QString m_name;
+    QString m_screen;
+    QAtomicPointer<QScreen> m_screenCache;
+    QMetaObject::Connection m_geometryConnection;
+    QMetaObject::Connection m_virtualGeometryConnection;
+    mutable QMutex m_geometryMutex;
+    QRect m_geometry;
+    QPointer<QWindow> m_focus;
+
+    Q_DISABLE_COPY(QBsdSeat)
+};
+
+QT_END_NAMESPACE
+
+#endif // QBSDSEAT_P_H
@@ -0,0 +1,153 @@
+/****************************************************************************
+**
+** Copyright (C) 2015-2016 Oleksandr Tymoshenko <gonzo@bluezbox.com>
+**
+** This file is part of the QtGui module of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:LGPL21$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see http://www.qt.io/terms-conditions. For further
+** information use the contact form at http://www.qt.io/contact-us.
+**
+** GNU Lesser General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU Lesser
+** General Public License version 2.1 or version 3 as published by the Free
+** Software Foundation and appearing in the file LICENSE.LGPLv21 and
+** LICENSE.LGPLv3 included in the packaging of this file. Please review the
+** following information to ensure the GNU Lesser General Public License
+** requirements will be met: https://www.gnu.org/licenses/lgpl.html and
+** http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+**
+** As a special exception, The Qt Company gives you certain additional
+** rights. These rights are described in The Qt Company LGPL Exception
+** version 1.1, included in the file LGPL_EXCEPTION.txt in this package.
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+#ifndef QBSDSHAREDINPUT_H
+#define QBSDSHAREDINPUT_H
+
+// Reader for the pointer and keyboard state the BSD input plugins publish
+// in POSIX shared memory when QT_BSD_INPUT_SHM is set. The header needs
+// neither Qt nor the plugins; copy it into the reading program:
+//
+//     QBsdSharedInputReader reader;
+//     QBsdSharedInputReader::Snapshot state;
+//     if (reader.open("/qt-bsd-input") && reader.read(&state))
+//         printf("%d,%d\n", state.x, state.y);
+//
+// read() never blocks the plugins. It gives up and returns false when it
+// cannot get a consistent copy, e.g. while the application is stopped in
+// the middle of an update.
+
+#include <atomic>
+
+#include <fcntl.h>
+#include <stdint.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+class QBsdSharedInputReader
+{
+public:
+    enum { Magic = 0x51425349, Version = 1 };   // "QBSI"
+
+    enum Lock {
+        CapsLock = 0x1,
+        NumLock = 0x2,
+        ScrollLock = 0x4
+    };
+
+    struct Snapshot {
+        int32_t x, y;               // global position, clamped to the screen
+        uint32_t buttons;           // Qt::MouseButtons
+        uint32_t modifiers;         // Qt::KeyboardModifiers
+        uint32_t locks;             // Lock flags
+        uint32_t sequence;          // even; changes with every update
+    };
+
+    // The object as the plugins write it. sequence is a seqlock: it is
+    // odd while an update is in progress.
+    struct Page {
+        uint32_t magic;
+        uint32_t version;
+        std::atomic<uint32_t> sequence;
+        std::atomic<int32_t> x;
+        std::atomic<int32_t> y;
+        std::atomic<uint32_t> buttons;
+        std::atomic<uint32_t> modifiers;
+        std::atomic<uint32_t> locks;
+    };
+
+    enum { MaxRetries = 1000 };
+
+    QBsdSharedInputReader() : m_page(0), m_size(0) { }
+    ~QBsdSharedInputReader() { close(); }
+
+    bool open(const char *name)
+    {
+        close();
+
+        const int fd = shm_open(name, O_RDONLY, 0);
+        if (fd < 0)
+            return false;
+
+        const size_t size = size_t(sysconf(_SC_PAGESIZE));
+        void *map = mmap(0, size, PROT_READ, MAP_SHARED, fd, 0);
+        ::close(fd);
+        if (map == MAP_FAILED)
+            return false;
+
+        m_page = static_cast<const Page *>(map);
+        m_size = size;
+        return true;
+    }
+
+    void close()
+    {
+        if (m_page)
+            munmap(const_cast<Page *>(m_page), m_size);
+        m_page = 0;
+        m_size = 0;
+    }
+
+    bool read(Snapshot *snapshot) const
+    {
+        if (!m_page || m_page->magic != Magic)
+            return false;
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (m_page->version != Version)
+            return false;
+
+        for (int i = 0; i < MaxRetries; ++i) {
+            const uint32_t sequence = m_page->sequence.load(std::memory_order_acquire);
+            if (sequence & 1)
+                continue;
+            snapshot->x = m_page->x.load(std::memory_order_relaxed);
+            snapshot->y = m_page->y.load(std::memory_order_relaxed);
+            snapshot->buttons = m_page->buttons.load(std::memory_order_relaxed);
+            snapshot->modifiers = m_page->modifiers.load(std::memory_order_relaxed);
+            snapshot->locks = m_page->locks.load(std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (m_page->sequence.load(std::memory_order_relaxed) == sequence) {
+                snapshot->sequence = sequence;
+                return true;
+            }
+        }
+        return false;
+    }
+
+private:
+    const Page *m_page;
+    size_t m_size;
+
+    QBsdSharedInputReader(const QBsdSharedInputReader &);
+    QBsdSharedInputReader &operator=(const QBsdSharedInputReader &);
+};
+
+#endif // QBSDSHAREDINPUT_H
@@ -0,0 +1,176 @@
+/****************************************************************************
+**
+** Copyright (C) 2015-2016 Oleksandr Tymoshenko <gonzo@bluezbox.com>
+**
+** This file is part of the QtGui module of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:LGPL21$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see http://www.qt.io/terms-conditions. For further
+** information use the contact form at http://www.qt.io/contact-us.
+**
+** GNU Lesser General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU Lesser
+** General Public License version 2.1 or version 3 as published by the Free
+** Software Foundation and appearing in the file LICENSE.LGPLv21 and
+** LICENSE.LGPLv3 included in the packaging of this file. Please review the
+** following information to ensure the GNU Lesser General Public License
+** requirements will be met: https://www.gnu.org/licenses/lgpl.html and
+** http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+**
+** As a special exception, The Qt Company gives you certain additional
+** rights. These rights are described in The Qt Company LGPL Exception
+** version 1.1, included in the file LGPL_EXCEPTION.txt in this package.
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+#ifndef QBSDSHAREDINPUT_P_H
+#define QBSDSHAREDINPUT_P_H
+
+//
+//  W A R N I N G
+//  -------------
+//
+// This file is not part of the Qt API.  It exists purely as an
+// implementation detail.  This header file may change from version to
+// version without notice, or even be removed.
+//
+// We mean it.
+//
+
+#include <QAtomicInteger>
+#include <QByteArray>
+
+#include <atomic>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include "qbsdsharedinput.h"
+
+QT_BEGIN_NAMESPACE
+
+// Live pointer and keyboard state in a POSIX shared memory object, for
+// overlays and watchdogs in other processes. Set QT_BSD_INPUT_SHM to the
+// object name, e.g. "/qt-bsd-input", to enable it.
+//
+// The page is a seqlock: sequence is odd while a handler updates it.
+// Readers use QBsdSharedInputReader from the public qbsdsharedinput.h,
+// which describes the same layout.
+struct QBsdSharedInputPage
+{
+    enum {
+        Magic = QBsdSharedInputReader::Magic,
+        Version = QBsdSharedInputReader::Version
+    };
+
+    enum Lock {
+        CapsLock = QBsdSharedInputReader::CapsLock,
+        NumLock = QBsdSharedInputReader::NumLock,
+        ScrollLock = QBsdSharedInputReader::ScrollLock
+    };
+
+    quint32 magic;
+    quint32 version;
+    QAtomicInteger<quint32> sequence;
+    QAtomicInteger<qint32> x;
+    QAtomicInteger<qint32> y;
+    QAtomicInteger<quint32> buttons;
+    QAtomicInteger<quint32> modifiers;
+    QAtomicInteger<quint32> locks;
+};
+
+// both describe the same eight 32-bit words
+Q_STATIC_ASSERT(sizeof(QBsdSharedInputPage) == sizeof(QBsdSharedInputReader::Page));
+
+// The writing side, owned by QBsdInputState. The keyboard and mouse
+// handlers may run in different threads, so updates take the odd sequence
+// number with a compare-and-swap; each one is a few stores.
+struct QBsdSharedInput
+{
+    QBsdSharedInput() : page(0) { }
+
+    void setup()
+    {
+        const QByteArray name = qgetenv("QT_BSD_INPUT_SHM");
+        if (name.isEmpty())
+            return;
+
+        const int fd = shm_open(name.constData(), O_RDWR | O_CREAT, 0644);
+        if (fd < 0) {
+            qErrnoWarning(errno, "shm_open(%s) failed", name.constData());
+            return;
+        }
+
+        const size_t size = size_t(sysconf(_SC_PAGESIZE));
+        void *map = MAP_FAILED;
+        if (ftruncate(fd, off_t(size)) == 0)
+            map = mmap(0, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        if (map == MAP_FAILED)
+            qErrnoWarning(errno, "Cannot map %s", name.constData());
+        close(fd);
+        if (map == MAP_FAILED)
+            return;
+
+        // readers check magic and version before trusting anything else
+        page = static_cast<QBsdSharedInputPage *>(map);
+        page->sequence.store(0);
+        page->x.store(0);
+        page->y.store(0);
+        page->buttons.store(0);
+        page->modifiers.store(0);
+        page->locks.store(0);
+        page->version = QBsdSharedInputPage::Version;
+        std::atomic_thread_fence(std::memory_order_release);
+        page->magic = QBsdSharedInputPage::Magic;
+    }
+
+    void publishPointer(int x, int y, quint32 buttons)
+    {
+        if (!page)
+            return;
+        const quint32 sequence = beginWrite();
+        page->x.store(x);
+        page->y.store(y);
+        page->buttons.store(buttons);
+        page->sequence.storeRelease(sequence + 2);
+    }
+
+    void publishKeyboard(quint32 modifiers, quint32 locks)
+    {
+        if (!page)
+            return;
+        const quint32 sequence = beginWrite();
+        page->modifiers.store(modifiers);
+        page->locks.store(locks);
+        page->sequence.storeRelease(sequence + 2);
+    }
+
+    QBsdSharedInputPage *page;
+
+private:
+    // returns the even sequence number the update started from
+    quint32 beginWrite()
+    {
+        for (;;) {
+            const quint32 sequence = page->sequence.load();
+            if (!(sequence & 1) && page->sequence.testAndSetAcquire(sequence, sequence + 1)) {
+                // the odd number must be visible before any of the new fields
+                std::atomic_thread_fence(std::memory_order_release);
+                return sequence;
+            }
+        }
+    }
+};
+
+QT_END_NAMESPACE
+
+#endif // QBSDSHAREDINPUT_P_H
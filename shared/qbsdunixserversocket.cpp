@@ -0,0 +1,125 @@
+/****************************************************************************
+**
+** Copyright (C) 2015-2016 Oleksandr Tymoshenko <gonzo@bluezbox.com>
+**
+** This file is part of the QtGui module of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:LGPL21$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see http://www.qt.io/terms-conditions. For further
+** information use the contact form at http://www.qt.io/contact-us.
+**
+** GNU Lesser General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU Lesser
+** General Public License version 2.1 or version 3 as published by the Free
+** Software Foundation and appearing in the file LICENSE.LGPLv21 and
+** LICENSE.LGPLv3 included in the packaging of this file. Please review the
+** following information to ensure the GNU Lesser General Public License
+** requirements will be met: https://www.gnu.org/licenses/lgpl.html and
+** http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+**
+** As a special exception, The Qt Company gives you certain additional
+** rights. These rights are described in The Qt Company LGPL Exception
+** version 1.1, included in the file LGPL_EXCEPTION.txt in this package.
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+#include "qbsdunixserversocket_p.h"
+
+#include <private/qcore_unix_p.h>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+QT_BEGIN_NAMESPACE
+
+bool QBsdUnixServerSocket::listen(const QByteArray &path, const char *what)
+{
+    close();
+
+    struct sockaddr_un addr;
+    if (size_t(path.size()) >= sizeof(addr.sun_path)) {
+        qWarning("Path of the %s socket too long: %s", what, path.constData());
+        return false;
+    }
+
+    // a socket left over from an earlier run is replaced, anything else
+    // at that path is not ours to remove
+    struct stat st;
+    if (::lstat(path.constData(), &st) == 0) {
+        if (!S_ISSOCK(st.st_mode)) {
+            qWarning("Not replacing %s with the %s socket, it is not a socket", path.constData(), what);
+            return false;
+        }
+        ::unlink(path.constData());
+    }
+
+    const int fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0) {
+        qErrnoWarning(errno, "socket() failed");
+        return false;
+    }
+    ::fcntl(fd, F_SETFD, FD_CLOEXEC);
+
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    memcpy(addr.sun_path, path.constData(), path.size());
+
+    // Created without access for anybody else, rather than restricted by
+    // a chmod() after the fact that a client could race. The umask is
+    // process wide, but the plugins set up their sockets from the GUI
+    // thread at startup.
+    const mode_t mask = ::umask(0077);
+    const int bound = ::bind(fd, reinterpret_cast<struct sockaddr *>(&addr), sizeof(addr));
+    const int bindError = errno;
+    ::umask(mask);
+
+    if (bound < 0 || ::listen(fd, 4) < 0) {
+        qErrnoWarning(bound < 0 ? bindError : errno, "Cannot listen on %s", path.constData());
+        if (bound == 0)
+            ::unlink(path.constData());
+        qt_safe_close(fd);
+        return false;
+    }
+
+    ::fcntl(fd, F_SETFL, O_NONBLOCK);
+
+    m_path = path;
+    m_fd = fd;
+    return true;
+}
+
+void QBsdUnixServerSocket::close()
+{
+    if (m_fd < 0)
+        return;
+    qt_safe_close(m_fd);
+    ::unlink(m_path.constData());
+    m_fd = -1;
+}
+
+int QBsdUnixServerSocket::accept()
+{
+    forever {
+        const int fd = ::accept(m_fd, 0, 0);
+        if (fd >= 0) {
+            ::fcntl(fd, F_SETFD, FD_CLOEXEC);
+            ::fcntl(fd, F_SETFL, O_NONBLOCK);
+            return fd;
+        }
+        if (errno != EINTR)
+            return -1;
+    }
+}
+
+QT_END_NAMESPACE
@@ -0,0 +1,80 @@
+/****************************************************************************
+**
+** Copyright (C) 2015-2016 Oleksandr Tymoshenko <gonzo@bluezbox.com>
+**
+** This file is part of the QtGui module of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:LGPL21$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see http://www.qt.io/terms-conditions. For further
+** information use the contact form at http://www.qt.io/contact-us.
+**
+** GNU Lesser General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU Lesser
+** General Public License version 2.1 or version 3 as published by the Free
+** Software Foundation and appearing in the file LICENSE.LGPLv21 and
+** LICENSE.LGPLv3 included in the packaging of this file. Please review the
+** following information to ensure the GNU Lesser General Public License
+** requirements will be met: https://www.gnu.org/licenses/lgpl.html and
+** http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+**
+** As a special exception, The Qt Company gives you certain additional
+** rights. These rights are described in The Qt Company LGPL Exception
+** version 1.1, included in the file LGPL_EXCEPTION.txt in this package.
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+#ifndef QBSDUNIXSERVERSOCKET_P_H
+#define QBSDUNIXSERVERSOCKET_P_H
+
+//
+//  W A R N I N G
+//  -------------
+//
+// This file is not part of the Qt API.  It exists purely as an
+// implementation detail.  This header file may change from version to
+// version without notice, or even be removed.
+//
+// We mean it.
+//
+
+#include <QByteArray>
+
+QT_BEGIN_NAMESPACE
+
+// Listening local stream socket of the injection server and the metrics
+// exporter. Only the owner can connect to it from the moment it exists.
+// A socket left over from an earlier run at the same path is replaced,
+// anything else there is left alone. The socket and the connections it
+// accepts are non-blocking and closed on exec; the path is removed again
+// when the socket is closed.
+class QBsdUnixServerSocket
+{
+public:
+    QBsdUnixServerSocket() : m_fd(-1) { }
+    ~QBsdUnixServerSocket() { close(); }
+
+    // what names the socket in warnings, e.g. "metrics"
+    bool listen(const QByteArray &path, const char *what);
+    void close();
+
+    int socketDescriptor() const { return m_fd; }
+
+    // the next pending connection, or -1 if there is none
+    int accept();
+
+private:
+    QByteArray m_path;
+    int m_fd;
+
+    Q_DISABLE_COPY(QBsdUnixServerSocket)
+};
+
+QT_END_NAMESPACE
+
+#endif // QBSDUNIXSERVERSOCKET_P_H
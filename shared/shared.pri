@@ -0,0 +1,50 @@
+INCLUDEPATH += $$PWD
+
+HEADERS += \
+    $$PWD/qbsddevicemonitor_p.h \
+    $$PWD/qbsdeventqueue_p.h \
+    $$PWD/qbsdflightrecorder_p.h \
+    $$PWD/qbsdinjectionserver_p.h \
+    $$PWD/qbsdinputlogging_p.h \
+    $$PWD/qbsdinputstate_p.h \
+    $$PWD/qbsdinputstats_p.h \
+    $$PWD/qbsdinputtrace_p.h \
+    $$PWD/qbsdmetricsexporter_p.h \
+    $$PWD/qbsdseat_p.h \
+    $$PWD/qbsdsharedinput.h \
+    $$PWD/qbsdsharedinput_p.h \
+    $$PWD/qbsdunixserversocket_p.h
+
+SOURCES += \
+    $$PWD/qbsddevicemonitor.cpp \
+    $$PWD/qbsdeventqueue.cpp \
+    $$PWD/qbsdinjectionserver.cpp \
+    $$PWD/qbsdinputlogging.cpp \
+    $$PWD/qbsdinputstats.cpp \
+    $$PWD/qbsdmetricsexporter.cpp \
+    $$PWD/qbsdseat.cpp \
+    $$PWD/qbsdunixserversocket.cpp
+
+OTHER_FILES += \
+    $$PWD/qbsdinput.d
+
+# static tracepoints, see qbsdinputtrace_p.h
+usdt {
+    DEFINES += QT_BSD_INPUT_USDT
+
+    freebsd {
+        DTRACE_PROVIDERS = $$PWD/qbsdinput.d
+
+        dtrace_header.input = DTRACE_PROVIDERS
+        dtrace_header.output = ${QMAKE_FILE_BASE}_provider.h
+        dtrace_header.commands = dtrace -h -s ${QMAKE_FILE_NAME} -o ${QMAKE_FILE_OUT}
+        dtrace_header.variable_out = HEADERS
+        dtrace_header.CONFIG += target_predeps no_link
+        QMAKE_EXTRA_COMPILERS += dtrace_header
+        INCLUDEPATH += $$OUT_PWD
+
+        # dtrace -G rewrites the probe sites in the objects and emits the provider
+        QMAKE_PRE_LINK += dtrace -G -s $$PWD/qbsdinput.d -o qbsdinput_probes.o $(OBJECTS)
+        LIBS += qbsdinput_probes.o
+    }
+}
@@ -0,0 +1,10 @@
+TARGET = tst_qbsdeventqueue
+
+QT += core-private gui-private testlib
+
+CONFIG += testcase
+CONFIG -= app_bundle
+
+SOURCES = tst_qbsdeventqueue.cpp
+
+include(../../shared/shared.pri)
@@ -0,0 +1,267 @@
+/****************************************************************************
+**
+** Copyright (C) 2015-2016 Oleksandr Tymoshenko <gonzo@bluezbox.com>
+**
+** This file is part of the QtGui module of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:LGPL21$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see http://www.qt.io/terms-conditions. For further
+** information use the contact form at http://www.qt.io/contact-us.
+**
+** GNU Lesser General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU Lesser
+** General Public License version 2.1 or version 3 as published by the Free
+** Software Foundation and appearing in the file LICENSE.LGPLv21 and
+** LICENSE.LGPLv3 included in the packaging of this file. Please review the
+** following information to ensure the GNU Lesser General Public License
+** requirements will be met: https://www.gnu.org/licenses/lgpl.html and
+** http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+**
+** As a special exception, The Qt Company gives you certain additional
+** rights. These rights are described in The Qt Company LGPL Exception
+** version 1.1, included in the file LGPL_EXCEPTION.txt in this package.
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+#include "qbsdeventqueue_p.h"
+
+#include <QtTest/QtTest>
+
+QT_BEGIN_NAMESPACE
+
+// A queue whose GUI thread lags behind on demand, and which records the
+// events it would hand to the window system.
+class RecordingQueue : public QBsdEventQueue
+{
+public:
+    RecordingQueue() : backedUp(false) { }
+
+    bool backedUp;
+    QVector<Event> delivered;
+
+protected:
+    bool isBackedUp() const override { return backedUp; }
+    void deliver(const Event &event) override { delivered.append(event); }
+};
+
+// Drives the real post() and flush() of QBsdEventQueue while it is held
+// back, as it is while the GUI thread lags behind.
+class tst_QBsdEventQueue : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void passesThrough();
+    void motionMerges();
+    void pressKeepsPosition();
+    void releaseKeepsPosition();
+    void pressAfterMotion();
+    void wheelSums();
+    void keyRepeats();
+    void flushKeepsOrder();
+    void overflowDeliversOldest();
+    void holdsUntilCommitSent();
+
+private:
+    typedef QBsdEventQueue::Event Event;
+
+    static void postKey(QBsdEventQueue &q, int nativecode, bool isPress);
+    static const QVector<Event> &events(const QBsdEventQueue &q) { return q.m_events; }
+    static void flush(QBsdEventQueue &q) { q.flush(); }
+    static QAtomicInt &guiSendsInFlight(QBsdEventQueue &q) { return *q.m_guiSendsInFlight; }
+};
+
+void tst_QBsdEventQueue::postKey(QBsdEventQueue &q, int nativecode, bool isPress)
+{
+    q.postKeyEvent(nativecode, QStringLiteral("a"), Qt::Key_A, Qt::NoModifier, isPress, false);
+}
+
+void tst_QBsdEventQueue::passesThrough()
+{
+    RecordingQueue q;
+    q.postMouseEvent(QPoint(1, 1), Qt::NoButton, Qt::NoModifier);
+    q.postMouseEvent(QPoint(2, 2), Qt::NoButton, Qt::NoModifier);
+
+    QCOMPARE(q.delivered.size(), 2);
+    QVERIFY(events(q).isEmpty());
+    QCOMPARE(q.coalesced(), quint64(0));
+}
+
+void tst_QBsdEventQueue::motionMerges()
+{
+    RecordingQueue q;
+    q.backedUp = true;
+    q.postMouseEvent(QPoint(1, 1), Qt::NoButton, Qt::NoModifier);
+    q.postMouseEvent(QPoint(2, 2), Qt::NoButton, Qt::NoModifier);
+    q.postMouseEvent(QPoint(3, 3), Qt::NoButton, Qt::NoModifier);
+
+    QVERIFY(q.delivered.isEmpty());
+    QCOMPARE(events(q).size(), 1);
+    QCOMPARE(q.coalesced(), quint64(2));
+
+    q.backedUp = false;
+    flush(q);
+    QCOMPARE(q.delivered.size(), 1);
+    QCOMPARE(q.delivered.at(0).pos, QPoint(3, 3));
+    QVERIFY(events(q).isEmpty());
+}
+
+void tst_QBsdEventQueue::pressKeepsPosition()
+{
+    RecordingQueue q;
+    q.backedUp = true;
+    q.postMouseEvent(QPoint(10, 10), Qt::LeftButton, Qt::NoModifier);
+    q.postMouseEvent(QPoint(20, 20), Qt::LeftButton, Qt::NoModifier);
+    q.postMouseEvent(QPoint(30, 30), Qt::LeftButton, Qt::NoModifier);
+
+    QCOMPARE(events(q).size(), 2);
+    QCOMPARE(events(q).at(0).pos, QPoint(10, 10));
+    QCOMPARE(events(q).at(0).buttons, Qt::MouseButtons(Qt::LeftButton));
+    QCOMPARE(events(q).at(1).pos, QPoint(30, 30));
+}
+
+void tst_QBsdEventQueue::releaseKeepsPosition()
+{
+    RecordingQueue q;
+    q.backedUp = true;
+    q.postMouseEvent(QPoint(10, 10), Qt::LeftButton, Qt::NoModifier);
+    q.postMouseEvent(QPoint(10, 10), Qt::NoButton, Qt::NoModifier);
+    q.postMouseEvent(QPoint(50, 50), Qt::NoButton, Qt::NoModifier);
+
+    QCOMPARE(events(q).size(), 3);
+    QCOMPARE(events(q).at(1).pos, QPoint(10, 10));
+    QCOMPARE(events(q).at(1).buttons, Qt::MouseButtons(Qt::NoButton));
+    QCOMPARE(events(q).at(2).pos, QPoint(50, 50));
+}
+
+void tst_QBsdEventQueue::pressAfterMotion()
+{
+    RecordingQueue q;
+    q.backedUp = true;
+    q.postMouseEvent(QPoint(1, 1), Qt::NoButton, Qt::NoModifier);
+    q.postMouseEvent(QPoint(2, 2), Qt::LeftButton, Qt::NoModifier);
+
+    QCOMPARE(events(q).size(), 2);
+    QCOMPARE(events(q).at(0).pos, QPoint(1, 1));
+    QCOMPARE(events(q).at(1).pos, QPoint(2, 2));
+}
+
+void tst_QBsdEventQueue::wheelSums()
+{
+    RecordingQueue q;
+    q.backedUp = true;
+    q.postWheelEvent(QPoint(5, 5), QPoint(0, 120), Qt::NoModifier);
+    q.postWheelEvent(QPoint(6, 6), QPoint(0, 120), Qt::NoModifier);
+
+    QCOMPARE(events(q).size(), 1);
+    QCOMPARE(events(q).at(0).pos, QPoint(6, 6));
+    QCOMPARE(events(q).at(0).angleDelta, QPoint(0, 240));
+}
+
+void tst_QBsdEventQueue::keyRepeats()
+{
+    RecordingQueue q;
+    q.backedUp = true;
+    postKey(q, 30, true);
+    postKey(q, 30, true);
+    postKey(q, 30, false);
+    postKey(q, 30, true);
+
+    QCOMPARE(events(q).size(), 3);
+    QVERIFY(events(q).at(0).isPress);
+    QVERIFY(!events(q).at(1).isPress);
+    QVERIFY(events(q).at(2).isPress);
+}
+
+void tst_QBsdEventQueue::flushKeepsOrder()
+{
+    RecordingQueue q;
+    q.backedUp = true;
+    q.postMouseEvent(QPoint(1, 1), Qt::NoButton, Qt::NoModifier);
+    postKey(q, 30, true);
+    q.postWheelEvent(QPoint(1, 1), QPoint(0, 120), Qt::NoModifier);
+    postKey(q, 30, false);
+    q.postMouseEvent(QPoint(1, 1), Qt::LeftButton, Qt::NoModifier);
+
+    // nothing goes out while the GUI thread is still behind
+    flush(q);
+    QVERIFY(q.delivered.isEmpty());
+
+    q.backedUp = false;
+    flush(q);
+    QCOMPARE(q.delivered.size(), 5);
+    QCOMPARE(q.delivered.at(0).type, Event::Mouse);
+    QCOMPARE(q.delivered.at(1).type, Event::Key);
+    QVERIFY(q.delivered.at(1).isPress);
+    QCOMPARE(q.delivered.at(2).type, Event::Wheel);
+    QCOMPARE(q.delivered.at(3).type, Event::Key);
+    QVERIFY(!q.delivered.at(3).isPress);
+    QCOMPARE(q.delivered.at(4).type, Event::Mouse);
+    QVERIFY(q.delivered.at(4).transition);
+    QVERIFY(events(q).isEmpty());
+
+    // and once the queue is empty, events go straight through again
+    postKey(q, 31, true);
+    QCOMPARE(q.delivered.size(), 6);
+    QVERIFY(events(q).isEmpty());
+}
+
+void tst_QBsdEventQueue::overflowDeliversOldest()
+{
+    RecordingQueue q;
+    q.backedUp = true;
+
+    // presses of different keys never merge
+    int posted = 0;
+    while (q.delivered.isEmpty() && posted < 100000)
+        postKey(q, posted++, true);
+
+    QCOMPARE(q.delivered.size(), 1);
+    QCOMPARE(q.delivered.at(0).nativecode, 0);
+    const int capacity = events(q).size();
+    QCOMPARE(capacity, posted - 1);
+
+    postKey(q, posted++, true);
+    QCOMPARE(q.delivered.size(), 2);
+    QCOMPARE(q.delivered.at(1).nativecode, 1);
+    QCOMPARE(events(q).size(), capacity);
+    QCOMPARE(events(q).first().nativecode, 2);
+    QCOMPARE(events(q).last().nativecode, posted - 1);
+}
+
+void tst_QBsdEventQueue::holdsUntilCommitSent()
+{
+    RecordingQueue q;
+    q.postCommit(QStringLiteral("0123456789"));
+    QCOMPARE(q.delivered.size(), 1);
+    QCOMPARE(q.delivered.at(0).type, Event::Commit);
+
+    // the GUI thread has not sent the commit yet
+    guiSendsInFlight(q).ref();
+    postKey(q, 28, true);
+    postKey(q, 28, false);
+    flush(q);
+    QCOMPARE(q.delivered.size(), 1);
+    QCOMPARE(events(q).size(), 2);
+
+    guiSendsInFlight(q).deref();
+    flush(q);
+    QCOMPARE(q.delivered.size(), 3);
+    QCOMPARE(q.delivered.at(1).nativecode, 28);
+    QVERIFY(q.delivered.at(1).isPress);
+    QVERIFY(!q.delivered.at(2).isPress);
+}
+
+QT_END_NAMESPACE
+
+QT_USE_NAMESPACE
+
+QTEST_GUILESS_MAIN(tst_QBsdEventQueue)
+#include "tst_qbsdeventqueue.moc"
@@ -0,0 +1,8 @@
+TARGET = bsdkbdstress
+
+QT += core gui
+
+CONFIG += console
+CONFIG -= app_bundle
+
+SOURCES = main.cpp
@@ -0,0 +1,452 @@
+/****************************************************************************
+**
+** Copyright (C) 2015-2016 Oleksandr Tymoshenko <gonzo@bluezbox.com>
+**
+** This file is part of the QtGui module of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:LGPL21$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see http://www.qt.io/terms-conditions. For further
+** information use the contact form at http://www.qt.io/contact-us.
+**
+** GNU Lesser General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU Lesser
+** General Public License version 2.1 or version 3 as published by the Free
+** Software Foundation and appearing in the file LICENSE.LGPLv21 and
+** LICENSE.LGPLv3 included in the packaging of this file. Please review the
+** following information to ensure the GNU Lesser General Public License
+** requirements will be met: https://www.gnu.org/licenses/lgpl.html and
+** http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+**
+** As a special exception, The Qt Company gives you certain additional
+** rights. These rights are described in The Qt Company LGPL Exception
+** version 1.1, included in the file LGPL_EXCEPTION.txt in this package.
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+// End-to-end stress test for the BsdKeyboard plugin.
+//
+// A pty stands in for the console: its slave side is handed to the plugin
+// as the keyboard device and a generator thread writes K_CODE bytes into
+// the master side at a controlled rate. An offscreen window counts the
+// key events that come out of Qt and measures how long each key press
+// took from write() to delivery.
+//
+// The exit status is non-zero when more events were lost, or the 99th
+// percentile latency was higher, than allowed, so the tool can gate
+// changes to the input path.
+
+#include <QCommandLineParser>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QGenericPluginFactory>
+#include <QGuiApplication>
+#include <QInputMethodEvent>
+#include <QKeyEvent>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QQueue>
+#include <QThread>
+#include <QTimer>
+#include <QVector>
+#include <QWindow>
+
+#include <algorithm>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <termios.h>
+#include <unistd.h>
+
+QT_USE_NAMESPACE
+
+// console keycodes, AT set 1 numbering
+enum {
+    KeyEnter = 28,
+    KeyCtrlL = 29,
+    KeyShiftL = 42,
+    KeyAltL = 56,
+    KeyReleased = 0x80
+};
+
+static const quint8 letterCodes[] = {
+    30, 48, 46, 32, 18, 33, 34, 35, 23, 36, 37, 38, 50,     // a .. m
+    49, 24, 25, 16, 19, 31, 20, 22, 47, 17, 45, 21, 44      // n .. z
+};
+
+static const quint8 digitCodes[] = {
+    11, 2, 3, 4, 5, 6, 7, 8, 9, 10                          // 0 .. 9
+};
+
+static const int ScannerLength = 12;
+static const int ScannerPauseMs = 200;
+
+enum Pattern {
+    Typing,
+    Scanner,
+    ModifierStorm
+};
+
+class Generator : public QThread
+{
+public:
+    Generator(int fd, Pattern pattern, int rate, int count, const QElapsedTimer *clock) :
+        m_fd(fd), m_pattern(pattern), m_rate(rate), m_count(count),
+        m_clock(clock), m_written(0), m_abort(false) { }
+
+    int written() const { return m_written.load(); }
+    void abort() { m_abort.store(true); }
+
+    // Matches a delivered key press against the presses written so far.
+    // Presses queued ahead of it were lost.
+    bool takePress(quint8 keycode, qint64 *sentAt, int *lost)
+    {
+        QMutexLocker locker(&m_mutex);
+        *lost = 0;
+        while (!m_presses.isEmpty()) {
+            const Press press = m_presses.dequeue();
+            if (press.keycode == keycode) {
+                *sentAt = press.sentAt;
+                return true;
+            }
+            ++*lost;
+        }
+        return false;
+    }
+
+    // Drops the presses a committed scan of count characters was made of;
+    // they arrive as text, not as key presses, and were not lost.
+    void takeScanned(int count)
+    {
+        QMutexLocker locker(&m_mutex);
+        for (int i = 0; i < count && !m_presses.isEmpty(); ++i)
+            m_presses.dequeue();
+    }
+
+protected:
+    void run() override
+    {
+        m_start = m_clock->nsecsElapsed();
+        m_slot = 0;
+
+        for (int i = 0; i < m_count && !m_abort.load(); ++i) {
+            switch (m_pattern) {
+            case Typing:
+                tap(letterCodes[i % int(sizeof(letterCodes))]);
+                break;
+            case Scanner:
+                if (i % (ScannerLength + 1) == ScannerLength) {
+                    tap(KeyEnter);
+                    // the operator picks up the next item
+                    QThread::msleep(ScannerPauseMs);
+                    m_start = m_clock->nsecsElapsed();
+                    m_slot = 0;
+                } else {
+                    tap(digitCodes[i % int(sizeof(digitCodes))]);
+                }
+                break;
+            case ModifierStorm: {
+                // every combination of Shift, Ctrl and Alt in turn
+                const int mods = i % 8;
+                if (mods & 1)
+                    write(KeyShiftL);
+                if (mods & 2)
+                    write(KeyCtrlL);
+                if (mods & 4)
+                    write(KeyAltL);
+                tap(letterCodes[i % int(sizeof(letterCodes))]);
+                if (mods & 4)
+                    write(KeyAltL | KeyReleased);
+                if (mods & 2)
+                    write(KeyCtrlL | KeyReleased);
+                if (mods & 1)
+                    write(KeyShiftL | KeyReleased);
+                break;
+            }
+            }
+        }
+    }
+
+private:
+    struct Press {
+        quint8 keycode;
+        qint64 sentAt;
+    };
+
+    void tap(quint8 keycode)
+    {
+        pace();
+        write(keycode);
+        write(keycode | KeyReleased);
+    }
+
+    // sleeps until the next keystroke is due; a rate of 0 means no pacing
+    void pace()
+    {
+        if (m_rate <= 0)
+            return;
+        const qint64 due = m_start + m_slot++ * (Q_INT64_C(1000000000) / m_rate);
+        const qint64 wait = due - m_clock->nsecsElapsed();
+        if (wait > 0)
+            QThread::usleep(wait / 1000);
+    }
+
+    bool write(quint8 byte)
+    {
+        if (!(byte & KeyReleased)) {
+            QMutexLocker locker(&m_mutex);
+            const Press press = { byte, m_clock->nsecsElapsed() };
+            m_presses.enqueue(press);
+        }
+
+        for (;;) {
+            if (::write(m_fd, &byte, 1) == 1) {
+                m_written.fetchAndAddRelaxed(1);
+                return true;
+            }
+            if (errno == EINTR)
+                continue;
+            if (errno != EAGAIN || m_abort.load())
+                return false;
+            // the pty is full: the plugin is not keeping up
+            struct pollfd pfd = { m_fd, POLLOUT, 0 };
+            poll(&pfd, 1, 10);
+        }
+    }
+
+    int m_fd;
+    Pattern m_pattern;
+    int m_rate;
+    int m_count;
+    const QElapsedTimer *m_clock;
+    qint64 m_start;
+    qint64 m_slot;
+    QAtomicInt m_written;
+    QAtomicInt m_abort;
+    QMutex m_mutex;
+    QQueue<Press> m_presses;
+};
+
+class CounterWindow : public QWindow
+{
+public:
+    CounterWindow(const QElapsedTimer *clock) :
+        m_clock(clock), m_generator(0), m_presses(0), m_releases(0), m_committed(0), m_lost(0) { }
+
+    void setGenerator(Generator *generator) { m_generator = generator; }
+
+    int events() const { return m_presses + m_releases; }
+    int committed() const { return m_committed; }
+    int lostPresses() const { return m_lost; }
+    QVector<qint64> latencies() const { return m_latencies; }
+
+protected:
+    bool event(QEvent *event) override
+    {
+        switch (event->type()) {
+        case QEvent::KeyPress: {
+            const qint64 now = m_clock->nsecsElapsed();
+            const QKeyEvent *keyEvent = static_cast<QKeyEvent *>(event);
+            qint64 sentAt;
+            int lost;
+            ++m_presses;
+            if (m_generator && m_generator->takePress(quint8(keyEvent->nativeScanCode()), &sentAt, &lost))
+                m_latencies.append(now - sentAt);
+            m_lost += lost;
+            return true;
+        }
+        case QEvent::KeyRelease:
+            ++m_releases;
+            return true;
+        case QEvent::InputMethod: {
+            // scanner=<ms> folds a burst into a single commit
+            const int scanned = static_cast<QInputMethodEvent *>(event)->commitString().size();
+            m_committed += scanned;
+            if (m_generator)
+                m_generator->takeScanned(scanned);
+            return true;
+        }
+        default:
+            break;
+        }
+        return QWindow::event(event);
+    }
+
+private:
+    const QElapsedTimer *m_clock;
+    Generator *m_generator;
+    int m_presses;
+    int m_releases;
+    int m_committed;
+    int m_lost;
+    QVector<qint64> m_latencies;
+};
+
+static int openPty(QByteArray *slaveName, int *slaveFd)
+{
+    int fd = posix_openpt(O_RDWR | O_NOCTTY);
+    if (fd < 0) {
+        perror("posix_openpt");
+        return -1;
+    }
+    if (grantpt(fd) < 0 || unlockpt(fd) < 0) {
+        perror("grantpt");
+        close(fd);
+        return -1;
+    }
+    *slaveName = ptsname(fd);
+
+    // hold the slave open so that writes succeed before the plugin opens
+    // it, and make it pass every byte through unchanged
+    *slaveFd = open(slaveName->constData(), O_RDWR | O_NOCTTY);
+    if (*slaveFd < 0) {
+        perror("open");
+        close(fd);
+        return -1;
+    }
+    struct termios tty;
+    if (tcgetattr(*slaveFd, &tty) == 0) {
+        cfmakeraw(&tty);
+        tcsetattr(*slaveFd, TCSANOW, &tty);
+    }
+
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+    return fd;
+}
+
+static qint64 percentile(const QVector<qint64> &sorted, int pct)
+{
+    if (sorted.isEmpty())
+        return 0;
+    return sorted.at(qMin(sorted.size() - 1, sorted.size() * pct / 100));
+}
+
+int main(int argc, char **argv)
+{
+    if (!qEnvironmentVariableIsSet("QT_QPA_PLATFORM"))
+        qputenv("QT_QPA_PLATFORM", "offscreen");
+
+    QGuiApplication app(argc, argv);
+    QCoreApplication::setApplicationName(QStringLiteral("bsdkbdstress"));
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription(QStringLiteral(
+        "Types into the BsdKeyboard plugin through a pty and reports lost events and latency.\n"
+        "The plugin is loaded from the generic plugin path; set QT_PLUGIN_PATH to test a build tree."));
+    parser.addHelpOption();
+    QCommandLineOption patternOption(QStringLiteral("pattern"),
+        QStringLiteral("typing, scanner or modifiers."), QStringLiteral("pattern"), QStringLiteral("typing"));
+    QCommandLineOption rateOption(QStringLiteral("rate"),
+        QStringLiteral("Keystrokes per second, 0 for as fast as possible."), QStringLiteral("rate"), QStringLiteral("100"));
+    QCommandLineOption countOption(QStringLiteral("count"),
+        QStringLiteral("Number of keystrokes."), QStringLiteral("count"), QStringLiteral("1000"));
+    QCommandLineOption specOption(QStringLiteral("spec"),
+        QStringLiteral("Additional plugin options, e.g. thread or scanner=30."), QStringLiteral("options"));
+    QCommandLineOption settleOption(QStringLiteral("settle"),
+        QStringLiteral("Milliseconds to wait for events after the last write."), QStringLiteral("ms"), QStringLiteral("1000"));
+    QCommandLineOption maxLossOption(QStringLiteral("max-loss"),
+        QStringLiteral("Lost events tolerated before failing."), QStringLiteral("events"), QStringLiteral("0"));
+    QCommandLineOption maxLatencyOption(QStringLiteral("max-latency"),
+        QStringLiteral("99th percentile latency tolerated before failing, 0 to not check."), QStringLiteral("ms"), QStringLiteral("0"));
+    parser.addOption(patternOption);
+    parser.addOption(rateOption);
+    parser.addOption(countOption);
+    parser.addOption(specOption);
+    parser.addOption(settleOption);
+    parser.addOption(maxLossOption);
+    parser.addOption(maxLatencyOption);
+    parser.process(app);
+
+    Pattern pattern = Typing;
+    const QString patternName = parser.value(patternOption);
+    if (patternName == QLatin1String("typing"))
+        pattern = Typing;
+    else if (patternName == QLatin1String("scanner"))
+        pattern = Scanner;
+    else if (patternName == QLatin1String("modifiers"))
+        pattern = ModifierStorm;
+    else
+        parser.showHelp(1);
+
+    QByteArray slaveName;
+    int slaveFd;
+    const int masterFd = openPty(&slaveName, &slaveFd);
+    if (masterFd < 0)
+        return 2;
+
+    QElapsedTimer clock;
+    clock.start();
+
+    CounterWindow window(&clock);
+    window.resize(64, 64);
+    window.show();
+    window.requestActivate();
+
+    QString spec = QFile::decodeName(slaveName) + QLatin1String(":novtswitch:raw");
+    if (parser.isSet(specOption))
+        spec += QLatin1Char(':') + parser.value(specOption);
+    QObject *handler = QGenericPluginFactory::create(QStringLiteral("BsdKeyboard"), spec);
+    if (!handler) {
+        fprintf(stderr, "bsdkbdstress: cannot load the BsdKeyboard plugin\n");
+        return 2;
+    }
+
+    Generator generator(masterFd, pattern, parser.value(rateOption).toInt(),
+                        parser.value(countOption).toInt(), &clock);
+    window.setGenerator(&generator);
+
+    QTimer settle;
+    settle.setSingleShot(true);
+    settle.setInterval(parser.value(settleOption).toInt());
+    QObject::connect(&generator, &QThread::finished, &settle, static_cast<void (QTimer::*)()>(&QTimer::start));
+    QObject::connect(&settle, &QTimer::timeout, &app, &QCoreApplication::quit);
+
+    const qint64 started = clock.nsecsElapsed();
+    generator.start();
+    app.exec();
+    generator.abort();
+    generator.wait();
+    const qint64 elapsed = clock.nsecsElapsed() - started;
+
+    delete handler;
+    close(slaveFd);
+    close(masterFd);
+
+    // every byte written is one key event, or part of a committed scan
+    const int written = generator.written();
+    const int delivered = window.events() + 2 * window.committed();
+    const int lost = qMax(0, written - delivered);
+
+    QVector<qint64> latencies = window.latencies();
+    std::sort(latencies.begin(), latencies.end());
+    qint64 total = 0;
+    for (qint64 latency : qAsConst(latencies))
+        total += latency;
+
+    printf("pattern:     %s\n", qPrintable(patternName));
+    printf("written:     %d bytes in %.3f s\n", written, elapsed / 1e9);
+    printf("delivered:   %d key events, %d committed characters\n", window.events(), window.committed());
+    printf("lost:        %d events (%d key presses)\n", lost, window.lostPresses());
+    if (!latencies.isEmpty()) {
+        printf("latency us:  min %lld  avg %lld  p50 %lld  p99 %lld  max %lld\n",
+               latencies.first() / 1000, total / latencies.size() / 1000,
+               percentile(latencies, 50) / 1000, percentile(latencies, 99) / 1000,
+               latencies.last() / 1000);
+    }
+
+    bool ok = lost <= parser.value(maxLossOption).toInt();
+    const qint64 maxLatency = parser.value(maxLatencyOption).toLongLong() * 1000000;
+    if (maxLatency > 0 && percentile(latencies, 99) > maxLatency)
+        ok = false;
+
+    return ok ? 0 : 1;
+}